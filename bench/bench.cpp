@@ -0,0 +1,487 @@
+#include "corpus.hpp"
+
+#include "lexer/batch.hpp"
+#include "lexer/hash.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/pipeline.hpp"
+#include "lexer/token_range.hpp"
+#include "parser/parser.hpp"
+#include "lexer/scan.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <ranges>
+#include <string>
+#include <vector>
+
+using namespace threeD;
+using namespace threeD::Lexer;
+
+#ifndef THREED_BENCH_BUILD_TYPE
+#define THREED_BENCH_BUILD_TYPE ""
+#endif
+
+// Every heap allocation of the process, lexer and bench alike
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+struct Result
+{
+	Bench::Mix mix;
+	size_t files = 0;
+	size_t bytes = 0;
+	size_t tokens = 0;
+	size_t errors = 0;
+	double seconds = 0;				/* Sum of every timed lex of every file */
+	uint64_t allocations = 0;		/* During the timed lexes */
+	double p50 = 0, p99 = 0;		/* Per file, in microseconds */
+	double parallelSeconds = 0;		/* One lexFiles() of the corpus, 0 if not run */
+	double sequentialSeconds = 0;	/* nextToken() loop feeding consume(), 0 if not run */
+	double pipelinedSeconds = 0;	/* PipelinedLexer feeding consume(), 0 if not run */
+	double loopSeconds = 0;			/* The next four feed consume() the same tokens, 0 if not run */
+	double rangeSeconds = 0;		/* for over a TokenRange */
+	double viewsSeconds = 0;		/* TokenRange through std::views::filter and transform */
+	double batchSeconds = 0;		/* tokenizeAll(), then a loop over the stream */
+	double parseSeconds = 0;		/* Parsing every file from its tokens, 0 if not run */
+	size_t nodes = 0;				/* In one parse of every file */
+	uint64_t parseAllocations = 0;
+
+	double megabytesPerSecond(unsigned repeat) const { return bytes * repeat / seconds / 1e6; }
+	double tokensPerSecond(unsigned repeat) const { return tokens * repeat / seconds; }
+	double allocationsPerToken(unsigned repeat) const { return tokens ? static_cast<double>(allocations) / (tokens * repeat) : 0; }
+};
+
+struct Options
+{
+	std::vector<Bench::Mix> mixes;
+	Bench::CorpusOptions corpus;
+	unsigned repeat = 5;
+	unsigned workers = 1;
+	bool pipeline = false;
+	bool range = false;
+	bool parse = false;
+	std::string json;
+	std::string write;
+	std::string label;
+};
+
+static double percentile(std::vector<double>& samples, double fraction)
+{
+	if (samples.empty())
+		return 0;
+	size_t rank = std::min(samples.size() - 1, static_cast<size_t>(fraction * samples.size()));
+	std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+	return samples[rank];
+}
+
+// Stands in for a parser or linter, a little work per token that reads its lexeme
+static uint64_t consume(uint64_t sum, const Token& token, std::string_view source)
+{
+	return mixHash(sum + contentHash(token.lexeme(source)) + static_cast<uint64_t>(token.type));
+}
+
+// Lexes and consumes every file on this thread, then with the lexer on its own
+static void runPipeline(const Options& options, SourceManager& sources, const std::vector<FileId>& files, Result& result)
+{
+	uint64_t sequentialSum = 0, pipelinedSum = 0;
+	for (unsigned r = 0; r < options.repeat; r++)
+	{
+		for (auto file : files)
+		{
+			auto source = sources.contents(file);
+			auto start = std::chrono::steady_clock::now();
+			Lexer::Lexer lexer(sources, file);
+			for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken())
+				sequentialSum = consume(sequentialSum, token, source);
+			auto middle = std::chrono::steady_clock::now();
+			Lexer::Lexer pipelined(sources, file);
+			PipelinedLexer pipeline(pipelined);
+			for (auto token = pipeline.next(); token.type != TokenType::EOF_; token = pipeline.next())
+				pipelinedSum = consume(pipelinedSum, token, source);
+			auto end = std::chrono::steady_clock::now();
+			result.sequentialSeconds += std::chrono::duration<double>(middle - start).count();
+			result.pipelinedSeconds += std::chrono::duration<double>(end - middle).count();
+		}
+	}
+	// Both loops must have seen the same tokens, which also keeps consume() from being optimized out
+	if (sequentialSum != pipelinedSum)
+	{
+		std::cerr << "pipelined tokens differ from sequential ones in " << Bench::mixName(result.mix) << std::endl;
+		result.errors++;
+	}
+}
+
+// The same tokens through each way of consuming a lexer, every one timed over all files
+static void runRange(const Options& options, SourceManager& sources, const std::vector<FileId>& files, Result& result)
+{
+	uint64_t sums[4] = {};
+	for (unsigned r = 0; r < options.repeat; r++)
+	{
+		for (auto file : files)
+		{
+			auto source = sources.contents(file);
+			auto start = std::chrono::steady_clock::now();
+			{
+				Lexer::Lexer lexer(sources, file);
+				for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken())
+					sums[0] = consume(sums[0], token, source);
+			}
+			auto ranged = std::chrono::steady_clock::now();
+			{
+				Lexer::Lexer lexer(sources, file);
+				for (const Token& token : TokenRange(lexer))
+					sums[1] = consume(sums[1], token, source);
+			}
+			auto viewed = std::chrono::steady_clock::now();
+			{
+				// The corpus has no errors, so the filter keeps every token
+				Lexer::Lexer lexer(sources, file);
+				auto valid = TokenRange(lexer)
+					| std::views::filter([](const Token& token) { return token.type != TokenType::ERROR; })
+					| std::views::transform([&](const Token& token) { return std::pair(token, token.lexeme(source)); });
+				for (auto [token, lexeme] : valid)
+					sums[2] = mixHash(sums[2] + contentHash(lexeme) + static_cast<uint64_t>(token.type));
+			}
+			auto batched = std::chrono::steady_clock::now();
+			{
+				Lexer::Lexer lexer(sources, file);
+				auto stream = lexer.tokenizeAll();
+				for (size_t i = 0; i < stream.size(); i++)
+					sums[3] = consume(sums[3], stream[i], source);
+			}
+			auto end = std::chrono::steady_clock::now();
+			result.loopSeconds += std::chrono::duration<double>(ranged - start).count();
+			result.rangeSeconds += std::chrono::duration<double>(viewed - ranged).count();
+			result.viewsSeconds += std::chrono::duration<double>(batched - viewed).count();
+			result.batchSeconds += std::chrono::duration<double>(end - batched).count();
+		}
+	}
+	if (sums[1] != sums[0] || sums[2] != sums[0] || sums[3] != sums[0])
+	{
+		std::cerr << "token range differs from nextToken() in " << Bench::mixName(result.mix) << std::endl;
+		result.errors++;
+	}
+}
+
+// Parses every file from tokens lexed up front, so only the parser is timed
+static void runParse(const Options& options, SourceManager& sources, const std::vector<FileId>& files, Result& result)
+{
+	std::vector<TokenStream> streams;
+	for (auto file : files)
+		streams.push_back(Lexer::Lexer(sources, file).tokenizeAll());
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		DiagnosticEngine diagnostics;
+		result.nodes += Parser::parse(streams[i], sources.contents(files[i]), diagnostics).size();
+		result.errors += diagnostics.size();
+	}
+
+	auto before = allocations.load();
+	for (unsigned r = 0; r < options.repeat; r++)
+	{
+		for (size_t i = 0; i < files.size(); i++)
+		{
+			DiagnosticEngine diagnostics;
+			auto start = std::chrono::steady_clock::now();
+			auto ast = Parser::parse(streams[i], sources.contents(files[i]), diagnostics);
+			result.parseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+	result.parseAllocations = allocations.load() - before;
+}
+
+static Result run(const Options& options, Bench::Mix mix, ThreadPool* pool)
+{
+	auto corpusOptions = options.corpus;
+	corpusOptions.mix = mix;
+	auto corpus = Bench::generateCorpus(corpusOptions);
+
+	if (!options.write.empty())
+	{
+		auto directory = std::filesystem::path(options.write) / Bench::mixName(mix);
+		std::filesystem::create_directories(directory);
+		for (size_t i = 0; i < corpus.size(); i++)
+		{
+			std::ofstream out(directory / ("bench" + std::to_string(i) + ".tds"), std::ios::binary);
+			out << corpus[i];
+		}
+	}
+
+	// The buffers borrow from corpus
+	SourceManager sources;
+	std::vector<FileId> files;
+	for (size_t i = 0; i < corpus.size(); i++)
+		files.push_back(sources.addBuffer(std::string(Bench::mixName(mix)) + "/bench" + std::to_string(i) + ".tds", SourceBuffer(corpus[i])));
+
+	Result result;
+	result.mix = mix;
+	result.files = files.size();
+
+	// Warm up the caches and the kernel dispatch, and count what one pass yields
+	for (auto file : files)
+	{
+		Lexer::Lexer lexer(sources, file);
+		result.bytes += sources.contents(file).size();
+		result.tokens += lexer.tokenizeAll().size();
+		result.errors += lexer.diagnostics().size();
+	}
+
+	std::vector<double> latencies;
+	latencies.reserve(files.size() * options.repeat);
+	auto before = allocations.load();
+	for (unsigned r = 0; r < options.repeat; r++)
+	{
+		for (auto file : files)
+		{
+			auto start = std::chrono::steady_clock::now();
+			Lexer::Lexer lexer(sources, file);
+			auto tokens = lexer.tokenizeAll();
+			auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			result.seconds += seconds;
+			latencies.push_back(seconds * 1e6);
+		}
+	}
+	// The latency samples were reserved up front, so every allocation counted is the lexer's
+	result.allocations = allocations.load() - before;
+	result.p50 = percentile(latencies, 0.50);
+	result.p99 = percentile(latencies, 0.99);
+
+	if (pool)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto lexed = lexFiles(sources, files, *pool);
+		result.parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (options.pipeline)
+		runPipeline(options, sources, files, result);
+	if (options.range)
+		runRange(options, sources, files, result);
+	if (options.parse)
+		runParse(options, sources, files, result);
+	return result;
+}
+
+static std::string escape(const std::string& text)
+{
+	std::string escaped;
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			escaped += c;
+	}
+	return escaped;
+}
+
+static void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results)
+{
+	out << std::setprecision(6);
+	out << "{\n";
+	out << "  \"schema\": 1,\n";
+	out << "  \"label\": \"" << escape(options.label) << "\",\n";
+	out << "  \"build_type\": \"" << escape(THREED_BENCH_BUILD_TYPE) << "\",\n";
+	out << "  \"kernels\": \"" << Scan::kernels().name << "\",\n";
+	out << "  \"seed\": " << options.corpus.seed << ",\n";
+	out << "  \"repeat\": " << options.repeat << ",\n";
+	out << "  \"workers\": " << options.workers << ",\n";
+	out << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto& result = results[i];
+		out << "    {\"mix\": \"" << Bench::mixName(result.mix) << "\""
+			<< ", \"files\": " << result.files
+			<< ", \"bytes\": " << result.bytes
+			<< ", \"tokens\": " << result.tokens
+			<< ", \"errors\": " << result.errors
+			<< ", \"mb_per_s\": " << result.megabytesPerSecond(options.repeat)
+			<< ", \"tokens_per_s\": " << result.tokensPerSecond(options.repeat)
+			<< ", \"allocations_per_token\": " << result.allocationsPerToken(options.repeat)
+			<< ", \"p50_us\": " << result.p50
+			<< ", \"p99_us\": " << result.p99;
+		if (result.parallelSeconds > 0)
+			out << ", \"parallel_mb_per_s\": " << result.bytes / result.parallelSeconds / 1e6;
+		if (result.pipelinedSeconds > 0)
+			out << ", \"sequential_consume_mb_per_s\": " << result.bytes * options.repeat / result.sequentialSeconds / 1e6
+				<< ", \"pipelined_consume_mb_per_s\": " << result.bytes * options.repeat / result.pipelinedSeconds / 1e6;
+		if (result.parseSeconds > 0)
+			out << ", \"parse_mb_per_s\": " << result.bytes * options.repeat / result.parseSeconds / 1e6
+				<< ", \"parse_nodes_per_s\": " << result.nodes * options.repeat / result.parseSeconds
+				<< ", \"nodes\": " << result.nodes
+				<< ", \"parse_allocations_per_node\": " << static_cast<double>(result.parseAllocations) / (result.nodes * options.repeat);
+		if (result.rangeSeconds > 0)
+			out << ", \"loop_consume_mb_per_s\": " << result.bytes * options.repeat / result.loopSeconds / 1e6
+				<< ", \"range_consume_mb_per_s\": " << result.bytes * options.repeat / result.rangeSeconds / 1e6
+				<< ", \"views_consume_mb_per_s\": " << result.bytes * options.repeat / result.viewsSeconds / 1e6
+				<< ", \"batch_consume_mb_per_s\": " << result.bytes * options.repeat / result.batchSeconds / 1e6;
+		out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+static void usage()
+{
+	std::cerr << "usage: threeD_bench [--mix all|script|identifiers|strings|comments|operators] [--size MB] [--files N]\n"
+		"                    [--seed N] [--repeat N] [-j workers] [--pipeline] [--range] [--parse] [--json path] [--label text] [--write directory]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	bool allMixes = true;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--mix" && hasValue)
+		{
+			std::string name = argv[++i];
+			Bench::Mix mix;
+			if (name == "all")
+				allMixes = true;
+			else if (Bench::parseMix(name, mix))
+			{
+				if (allMixes)
+					options.mixes.clear();
+				allMixes = false;
+				options.mixes.push_back(mix);
+			}
+			else
+			{
+				usage();
+				return 2;
+			}
+		}
+		else if (arg == "--size" && hasValue)
+			options.corpus.bytes = static_cast<size_t>(std::strtod(argv[++i], nullptr) * (1 << 20));
+		else if (arg == "--files" && hasValue)
+			options.corpus.files = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--seed" && hasValue)
+			options.corpus.seed = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--repeat" && hasValue)
+			options.repeat = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "-j" && hasValue)
+			options.workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--pipeline")
+			options.pipeline = true;
+		else if (arg == "--range")
+			options.range = true;
+		else if (arg == "--parse")
+			options.parse = true;
+		else if (arg == "--json" && hasValue)
+			options.json = argv[++i];
+		else if (arg == "--label" && hasValue)
+			options.label = argv[++i];
+		else if (arg == "--write" && hasValue)
+			options.write = argv[++i];
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+
+	if (allMixes)
+		options.mixes.assign(std::begin(Bench::allMixes), std::end(Bench::allMixes));
+
+	std::string buildType = THREED_BENCH_BUILD_TYPE;
+	if (buildType != "Release" && buildType != "RelWithDebInfo")
+		std::cerr << "warning: built without optimizations (CMAKE_BUILD_TYPE \"" << buildType << "\"), numbers are not comparable" << std::endl;
+
+	// -j 1 skips the parallel pass, the per file numbers are always single threaded
+	std::unique_ptr<ThreadPool> pool;
+	if (options.workers != 1)
+	{
+		pool = std::make_unique<ThreadPool>(options.workers);
+		options.workers = pool->size();
+	}
+
+	std::vector<Result> results;
+	size_t errors = 0;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::left << std::setw(12) << "mix" << std::right
+		<< std::setw(8) << "MB" << std::setw(10) << "MB/s" << std::setw(10) << "Mtok/s"
+		<< std::setw(10) << "alloc/tok" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us";
+	if (pool)
+		std::cout << std::setw(12) << "MB/s x" << pool->size();
+	// Lexing plus consume(), on one thread and pipelined over two
+	if (options.pipeline)
+		std::cout << std::setw(10) << "seq MB/s" << std::setw(11) << "pipe MB/s";
+	// Lexing plus consume(), through nextToken(), TokenRange, std::views and tokenizeAll()
+	if (options.range)
+		std::cout << std::setw(11) << "loop MB/s" << std::setw(12) << "range MB/s" << std::setw(12) << "views MB/s" << std::setw(12) << "batch MB/s";
+	// Parsing alone, from tokens lexed beforehand
+	if (options.parse)
+		std::cout << std::setw(12) << "parse MB/s" << std::setw(11) << "Mnode/s" << std::setw(12) << "alloc/node";
+	std::cout << "\n";
+
+	for (auto mix : options.mixes)
+	{
+		auto result = run(options, mix, pool.get());
+		errors += result.errors;
+
+		std::cout << std::left << std::setw(12) << Bench::mixName(mix) << std::right
+			<< std::setw(8) << result.bytes / 1e6
+			<< std::setw(10) << result.megabytesPerSecond(options.repeat)
+			<< std::setw(10) << result.tokensPerSecond(options.repeat) / 1e6
+			<< std::setw(10) << std::setprecision(4) << result.allocationsPerToken(options.repeat) << std::setprecision(2)
+			<< std::setw(10) << result.p50
+			<< std::setw(10) << result.p99;
+		if (pool)
+			std::cout << std::setw(12) << result.bytes / result.parallelSeconds / 1e6;
+		if (options.pipeline)
+			std::cout << std::setw(10) << result.bytes * options.repeat / result.sequentialSeconds / 1e6
+				<< std::setw(11) << result.bytes * options.repeat / result.pipelinedSeconds / 1e6;
+		if (options.range)
+			std::cout << std::setw(11) << result.bytes * options.repeat / result.loopSeconds / 1e6
+				<< std::setw(12) << result.bytes * options.repeat / result.rangeSeconds / 1e6
+				<< std::setw(12) << result.bytes * options.repeat / result.viewsSeconds / 1e6
+				<< std::setw(12) << result.bytes * options.repeat / result.batchSeconds / 1e6;
+		if (options.parse)
+			std::cout << std::setw(12) << result.bytes * options.repeat / result.parseSeconds / 1e6
+				<< std::setw(11) << result.nodes * options.repeat / result.parseSeconds / 1e6
+				<< std::setw(12) << std::setprecision(4) << static_cast<double>(result.parseAllocations) / (result.nodes * options.repeat) << std::setprecision(2);
+		std::cout << std::endl;
+		results.push_back(result);
+	}
+
+	if (!options.json.empty())
+	{
+		std::ofstream out(options.json);
+		writeJson(out, options, results);
+		if (!out)
+		{
+			std::cerr << "Could not write " << options.json << std::endl;
+			return 1;
+		}
+	}
+
+	// The generator only writes valid scripts, an error is a lexer or parser regression
+	if (errors)
+	{
+		std::cerr << errors << " errors in the generated corpus" << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,332 @@
+#include "corpus.hpp"
+
+#include <algorithm>
+
+namespace threeD { namespace Bench {
+
+	const char* mixName(Mix mix)
+	{
+		switch (mix)
+		{
+		case Mix::Script: return "script";
+		case Mix::Identifiers: return "identifiers";
+		case Mix::Strings: return "strings";
+		case Mix::Comments: return "comments";
+		case Mix::Operators: return "operators";
+		}
+		return "unknown";
+	}
+
+	bool parseMix(std::string_view name, Mix& mix)
+	{
+		for (auto candidate : allMixes)
+		{
+			if (name == mixName(candidate))
+			{
+				mix = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// splitmix64, std:: distributions differ between standard libraries
+	class Random
+	{
+	public:
+		explicit Random(uint64_t seed) : state(seed) {}
+
+		uint64_t next()
+		{
+			uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+
+		// Uniform in [0, n)
+		size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+		// Uniform in [low, high]
+		size_t between(size_t low, size_t high) { return low + below(high - low + 1); }
+		bool chance(unsigned percent) { return below(100) < percent; }
+
+		template<size_t N>
+		const char* pick(const char* const (&words)[N]) { return words[below(N)]; }
+
+	private:
+		uint64_t state;
+	};
+
+	// None of them is a keyword, whatever case they are joined in
+	constexpr const char* words[] = {
+		"answer", "life", "universe", "everything", "value", "count", "index", "buffer",
+		"token", "source", "line", "offset", "result", "left", "right", "node",
+		"scope", "frame", "width", "height", "depth", "color", "vector", "matrix",
+		"angle", "speed", "mass", "force", "time", "delta", "scale", "world",
+	};
+
+	constexpr const char* shortNames[] = {"a", "b", "c", "i", "j", "k", "n", "x", "y", "z", "t0", "t1"};
+	constexpr const char* binaryOperators[] = {"+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&&", "||"};
+	constexpr const char* assignOperators[] = {":=", "+=", "-=", "*=", "/="};
+	constexpr const char* escapes[] = {"\\t", "\\n", "\\\"", "\\\\", "\\'", "\\0"};
+
+	enum Statement { LetExpression, LetString, LineComment, BlockComment, Call, Assign, Return, StatementCount };
+
+	// How often each statement appears and what goes into it
+	struct Profile
+	{
+		unsigned weights[StatementCount];
+		size_t identifierWords;		/* Most words joined into one identifier */
+		size_t expressionDepth;		/* Deepest nesting of binary expressions */
+		unsigned shortOperands;		/* Percent of operands that are one or two letter names */
+		size_t callArguments;		/* Most arguments of a call */
+		size_t stringWords;			/* Most words in a string literal */
+		size_t commentWords;		/* Most words in a comment line */
+	};
+
+	static Profile profile(Mix mix)
+	{
+		//                   let  str  //  /**/ call  :=  ret
+		switch (mix)
+		{
+		case Mix::Identifiers:
+			return {{3, 0, 0, 0, 5, 2, 1}, 5, 1, 0, 6, 4, 6};
+		case Mix::Strings:
+			return {{1, 8, 0, 0, 2, 0, 1}, 2, 1, 30, 3, 16, 6};
+		case Mix::Comments:
+			return {{1, 0, 5, 4, 0, 0, 1}, 2, 1, 30, 2, 6, 14};
+		case Mix::Operators:
+			return {{4, 0, 0, 0, 1, 3, 1}, 1, 4, 80, 2, 4, 6};
+		case Mix::Script:
+		default:
+			return {{4, 2, 2, 1, 2, 1, 1}, 3, 2, 30, 3, 6, 8};
+		}
+	}
+
+	class Generator
+	{
+	public:
+		Generator(Mix mix, uint64_t seed) : random(seed), shape(profile(mix)) {}
+
+		std::string file(size_t size)
+		{
+			out.clear();
+			out.reserve(size + 256);
+			while (out.size() < size)
+				function();
+			return std::move(out);
+		}
+
+	private:
+		void identifier(size_t maxWords)
+		{
+			size_t count = random.between(1, maxWords);
+			for (size_t i = 0; i < count; i++)
+			{
+				std::string_view word = random.pick(words);
+				out += i == 0 ? word[0] : static_cast<char>(word[0] - 'a' + 'A');
+				out += word.substr(1);
+				if (i + 1 < count && random.chance(5))
+					out += '_';
+			}
+			if (random.chance(10))
+				out += std::to_string(random.below(100));
+		}
+
+		void name()
+		{
+			if (random.chance(shape.shortOperands))
+				out += random.pick(shortNames);
+			else
+				identifier(shape.identifierWords);
+		}
+
+		void number()
+		{
+			static const char hex[] = "0123456789abcdef";
+			switch (random.below(8))
+			{
+			case 0: out += "0x"; for (size_t i = random.between(1, 8); i > 0; i--) out += hex[random.below(16)]; break;
+			case 1: out += "0b"; for (size_t i = random.between(1, 8); i > 0; i--) out += random.chance(50) ? '1' : '0'; break;
+			case 2: out += "0o"; for (size_t i = random.between(1, 3); i > 0; i--) out += hex[random.below(8)]; break;
+			case 3: out += std::to_string(random.below(1000)) + "." + std::to_string(random.below(1000)); break;
+			default: out += std::to_string(random.between(1, 100000)); break;
+			}
+		}
+
+		void string()
+		{
+			out += '"';
+			for (size_t i = random.between(1, shape.stringWords); i > 0; i--)
+			{
+				out += random.pick(words);
+				if (random.chance(15))
+					out += random.pick(escapes);
+				if (i > 1)
+					out += random.chance(10) ? "/* " : " ";
+			}
+			out += '"';
+		}
+
+		void operand(size_t depth)
+		{
+			switch (random.below(10))
+			{
+			case 0: out += random.chance(50) ? "true" : "false"; break;
+			case 1: case 2: number(); break;
+			case 3:
+				if (depth > 0)
+				{
+					out += '(';
+					expression(depth - 1);
+					out += ')';
+					break;
+				}
+				[[fallthrough]];
+			case 4:
+				if (depth > 0)
+				{
+					call(depth - 1);
+					break;
+				}
+				[[fallthrough]];
+			default:
+				if (random.chance(5))
+					out += '!';
+				name();
+				break;
+			}
+		}
+
+		void expression(size_t depth)
+		{
+			operand(depth);
+			for (size_t i = random.below(depth + 2); i > 0; i--)
+			{
+				out += ' ';
+				out += random.pick(binaryOperators);
+				out += ' ';
+				operand(depth);
+			}
+		}
+
+		void call(size_t depth)
+		{
+			identifier(shape.identifierWords);
+			out += '(';
+			for (size_t i = random.below(shape.callArguments + 1); i > 0; i--)
+			{
+				expression(depth);
+				if (i > 1)
+					out += ", ";
+			}
+			out += ')';
+		}
+
+		void comment()
+		{
+			for (size_t i = random.between(1, shape.commentWords); i > 0; i--)
+			{
+				out += ' ';
+				out += random.pick(words);
+			}
+		}
+
+		void statement(size_t indent)
+		{
+			unsigned total = 0;
+			for (auto weight : shape.weights)
+				total += weight;
+
+			size_t roll = random.below(total), kind = 0;
+			while (roll >= shape.weights[kind])
+				roll -= shape.weights[kind++];
+
+			out.append(indent, '\t');
+			switch (kind)
+			{
+			case LetExpression:
+				out += "let ";
+				name();
+				out += " := ";
+				expression(shape.expressionDepth);
+				break;
+			case LetString:
+				out += "let ";
+				identifier(shape.identifierWords);
+				out += " := ";
+				string();
+				break;
+			case LineComment:
+				out += "//";
+				comment();
+				break;
+			case BlockComment:
+				out += "/*";
+				for (size_t lines = random.between(1, 4); lines > 1; lines--)
+				{
+					comment();
+					out += '\n';
+					out.append(indent + 1, '\t');
+				}
+				comment();
+				out += " */";
+				break;
+			case Call:
+				call(shape.expressionDepth);
+				break;
+			case Assign:
+				name();
+				out += ' ';
+				out += random.pick(assignOperators);
+				out += ' ';
+				expression(shape.expressionDepth);
+				break;
+			case Return:
+				out += "ret ";
+				expression(shape.expressionDepth);
+				break;
+			}
+			out += '\n';
+		}
+
+		void function()
+		{
+			out += "def ";
+			identifier(shape.identifierWords);
+			out += '(';
+			for (size_t i = random.below(4); i > 0; i--)
+			{
+				name();
+				out += ": int";
+				if (i > 1)
+					out += ", ";
+			}
+			out += ") -> int:\n";
+
+			for (size_t i = random.between(4, 24); i > 0; i--)
+				statement(1 + (random.chance(20) ? 1 : 0));
+			out += '\n';
+		}
+
+		Random random;
+		Profile shape;
+		std::string out;
+	};
+
+	std::vector<std::string> generateCorpus(const CorpusOptions& options)
+	{
+		size_t files = std::max<size_t>(options.files, 1);
+		size_t average = options.bytes / files;
+
+		// The seed and the mix pick the stream, so mixes do not share files
+		Random sizes(options.seed);
+		Generator generator(options.mix, options.seed * 31 + static_cast<uint64_t>(options.mix));
+
+		std::vector<std::string> corpus;
+		for (size_t i = 0; i < files; i++)
+			corpus.push_back(generator.file(average / 4 + sizes.below(average * 3 / 2 + 1)));
+		return corpus;
+	}
+
+}}
@@ -0,0 +1,42 @@
+#ifndef __CORPUS_H__
+#define __CORPUS_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Bench {
+
+	// Token mix of a generated corpus
+	enum class Mix
+	{
+		Script,			/* Like examples/scripts/script.tds */
+		Identifiers,	/* Long identifiers and calls */
+		Strings,		/* String literals with escapes */
+		Comments,		/* Line and block comments */
+		Operators,		/* Short operands and deep expressions */
+	};
+
+	constexpr Mix allMixes[] = {Mix::Script, Mix::Identifiers, Mix::Strings, Mix::Comments, Mix::Operators};
+
+	const char* mixName(Mix mix);
+	// False if name is not the name of a mix
+	bool parseMix(std::string_view name, Mix& mix);
+
+	struct CorpusOptions
+	{
+		Mix mix = Mix::Script;
+		size_t bytes = 16 << 20;	/* Total size, files end on a whole line so it is approximate */
+		size_t files = 64;			/* Sizes spread from a quarter to seven quarters of the average */
+		uint64_t seed = 1;
+	};
+
+	// Source of every file. The same options give the same bytes on every
+	// platform and standard library, and the lexer accepts all of it.
+	std::vector<std::string> generateCorpus(const CorpusOptions& options);
+
+}}
+
+#endif // __CORPUS_H__
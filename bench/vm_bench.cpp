@@ -0,0 +1,313 @@
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+#include "vm/compiler.hpp"
+#include "vm/machine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace threeD;
+
+#ifndef THREED_BENCH_BUILD_TYPE
+#define THREED_BENCH_BUILD_TYPE ""
+#endif
+
+// Loops are tail calls, the language has no other way to repeat
+static const char* const program = R"(def fib(n: int) -> int:
+	ret n < 2 ? n : fib(n - 1) + fib(n - 2)
+
+def sumTo(n: int, acc: int) -> int:
+	ret n == 0 ? acc : sumTo(n - 1, acc + n)
+
+def collatz(n: int, steps: int) -> int:
+	ret n == 1 ? steps : collatz(n % 2 == 0 ? n / 2 : 3 * n + 1, steps + 1)
+
+def collatzAll(i: int, n: int, total: int) -> int:
+	ret i > n ? total : collatzAll(i + 1, n, total + collatz(i, 0))
+
+def gcd(a: int, b: int) -> int:
+	ret b == 0 ? a : gcd(b, a % b)
+
+def gcdAll(i: int, n: int, acc: int) -> int:
+	ret i > n ? acc : gcdAll(i + 1, n, acc + gcd(i * 7919 % 100003, i))
+
+def poly(i: int, n: int, acc: int) -> int:
+	let x := i * 0.001
+	let y := ((2.5 * x - 1.25) * x + 0.5) * x + 3.0
+	ret i == n ? acc : poly(i + 1, n, acc + y)
+
+def mix(i: int, n: int, acc: int) -> int:
+	let a := i
+	a += 3
+	a *= 7
+	a -= i
+	let b := a % 11 == 0 || a > 100 && !(i < 3)
+	acc += b ? a / 2 : -a
+	ret i >= n ? acc : mix(i + 1, n, acc)
+)";
+
+// The same functions in C++, for the expected results and a reference time
+namespace Native {
+
+	static int64_t fib(int64_t n)
+	{
+		return n < 2 ? n : fib(n - 1) + fib(n - 2);
+	}
+
+	static int64_t sumTo(int64_t n, int64_t acc)
+	{
+		for (; n != 0; n--)
+			acc += n;
+		return acc;
+	}
+
+	static int64_t collatzAll(int64_t i, int64_t n, int64_t total)
+	{
+		for (; i <= n; i++)
+		{
+			for (int64_t value = i; value != 1; total++)
+				value = value % 2 == 0 ? value / 2 : 3 * value + 1;
+		}
+		return total;
+	}
+
+	static int64_t gcdAll(int64_t i, int64_t n, int64_t acc)
+	{
+		for (; i <= n; i++)
+		{
+			int64_t a = i * 7919 % 100003, b = i;
+			while (b != 0)
+				a = std::exchange(b, a % b);
+			acc += a;
+		}
+		return acc;
+	}
+
+	static int64_t poly(int64_t i, int64_t n, int64_t acc)
+	{
+		for (;; i++)
+		{
+			double x = i * 0.001;
+			double y = ((2.5 * x - 1.25) * x + 0.5) * x + 3.0;
+			if (i == n)
+				return acc;
+			acc = static_cast<int64_t>(acc + y);
+		}
+	}
+
+	static int64_t mix(int64_t i, int64_t n, int64_t acc)
+	{
+		for (;; i++)
+		{
+			int64_t a = (i + 3) * 7 - i;
+			bool b = a % 11 == 0 || (a > 100 && !(i < 3));
+			acc += b ? a / 2 : -a;
+			if (i >= n)
+				return acc;
+		}
+	}
+
+}
+
+struct Case
+{
+	const char* name;
+	const char* function;
+	std::vector<int64_t> arguments;
+	int64_t (*native)(const std::vector<int64_t>&);
+	uint64_t (*operations)(int64_t result);	/* What one "op" is differs per case, see below */
+};
+
+static const Case cases[] = {
+	// One op is one call
+	{"fib", "fib", {27}, [](auto& a) { return Native::fib(a[0]); }, [](int64_t) -> uint64_t { return 2 * 317811 - 1; }},
+	// One op is one iteration
+	{"sum", "sumTo", {2000000, 0}, [](auto& a) { return Native::sumTo(a[0], a[1]); }, [](int64_t) -> uint64_t { return 2000000; }},
+	// One op is one collatz step
+	{"collatz", "collatzAll", {1, 30000, 0}, [](auto& a) { return Native::collatzAll(a[0], a[1], a[2]); }, [](int64_t steps) -> uint64_t { return static_cast<uint64_t>(steps); }},
+	// One op is one gcd
+	{"gcd", "gcdAll", {1, 200000, 0}, [](auto& a) { return Native::gcdAll(a[0], a[1], a[2]); }, [](int64_t) -> uint64_t { return 200000; }},
+	// One op is one polynomial, float arithmetic
+	{"poly", "poly", {0, 1000000, 0}, [](auto& a) { return Native::poly(a[0], a[1], a[2]); }, [](int64_t) -> uint64_t { return 1000000; }},
+	// One op is one iteration of compound assignments, && || and ?:
+	{"mix", "mix", {0, 1000000, 0}, [](auto& a) { return Native::mix(a[0], a[1], a[2]); }, [](int64_t) -> uint64_t { return 1000001; }},
+};
+
+struct Result
+{
+	const Case* test;
+	int64_t value = 0;
+	uint64_t operations = 0;
+	double seconds = std::numeric_limits<double>::max();		/* Fastest of the repeats */
+	double nativeSeconds = std::numeric_limits<double>::max();
+	bool correct = false;
+
+	double nanosecondsPerOperation() const { return seconds * 1e9 / operations; }
+	double nativeNanosecondsPerOperation() const { return nativeSeconds * 1e9 / operations; }
+};
+
+struct Options
+{
+	std::vector<std::string> cases;		/* Empty for every case */
+	unsigned repeat = 5;
+	bool disassemble = false;
+	std::string json;
+	std::string label;
+};
+
+static std::string escape(const std::string& text)
+{
+	std::string escaped;
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		if (static_cast<unsigned char>(c) >= 0x20)
+			escaped += c;
+	}
+	return escaped;
+}
+
+static void writeJson(std::ostream& out, const Options& options, const std::vector<Result>& results)
+{
+	out << std::setprecision(6);
+	out << "{\n";
+	out << "  \"schema\": 1,\n";
+	out << "  \"label\": \"" << escape(options.label) << "\",\n";
+	out << "  \"build_type\": \"" << escape(THREED_BENCH_BUILD_TYPE) << "\",\n";
+	out << "  \"dispatch\": \"" << Vm::Machine::dispatch() << "\",\n";
+	out << "  \"repeat\": " << options.repeat << ",\n";
+	out << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto& result = results[i];
+		out << "    {\"case\": \"" << result.test->name << "\""
+			<< ", \"result\": " << result.value
+			<< ", \"correct\": " << (result.correct ? "true" : "false")
+			<< ", \"ops\": " << result.operations
+			<< ", \"ns_per_op\": " << result.nanosecondsPerOperation()
+			<< ", \"native_ns_per_op\": " << result.nativeNanosecondsPerOperation()
+			<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+static void usage()
+{
+	std::cerr << "usage: threeD_vmbench [--case fib|sum|collatz|gcd|poly|mix] [--repeat N] [--disassemble] [--json path] [--label text]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--case" && hasValue)
+			options.cases.push_back(argv[++i]);
+		else if (arg == "--repeat" && hasValue)
+			options.repeat = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--disassemble")
+			options.disassemble = true;
+		else if (arg == "--json" && hasValue)
+			options.json = argv[++i];
+		else if (arg == "--label" && hasValue)
+			options.label = argv[++i];
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+
+	std::string buildType = THREED_BENCH_BUILD_TYPE;
+	if (buildType != "Release" && buildType != "RelWithDebInfo")
+		std::cerr << "warning: built without optimizations (CMAKE_BUILD_TYPE \"" << buildType << "\"), numbers are not comparable" << std::endl;
+
+	std::string_view source = program;
+	Lexer::SourceManager sources;
+	auto file = sources.addBuffer("vm_bench.tds", Lexer::SourceBuffer(source));
+	Lexer::Lexer lexer(sources, file);
+	auto tokens = lexer.tokenizeAll();
+	Lexer::DiagnosticEngine diagnostics;
+	auto ast = Parser::parse(tokens, source, diagnostics);
+	auto compiled = Vm::compile(ast, tokens, source, diagnostics);
+	if (lexer.diagnostics().size() || diagnostics.size())
+	{
+		lexer.diagnostics().print(std::cerr, sources);
+		diagnostics.print(std::cerr, sources);
+		return 1;
+	}
+	if (options.disassemble)
+		Vm::disassemble(std::cout, compiled);
+
+	Vm::Machine machine(compiled);
+	std::vector<Result> results;
+	bool failed = false;
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "dispatch: " << Vm::Machine::dispatch() << "\n";
+	std::cout << std::left << std::setw(10) << "case" << std::right
+		<< std::setw(12) << "Mops" << std::setw(10) << "ns/op" << std::setw(12) << "native ns" << std::setw(10) << "x native" << "\n";
+
+	for (auto& test : cases)
+	{
+		if (!options.cases.empty() && std::find(options.cases.begin(), options.cases.end(), test.name) == options.cases.end())
+			continue;
+
+		Result result;
+		result.test = &test;
+		auto function = compiled.find(test.function);
+		int64_t expected = 0;
+		for (unsigned r = 0; r < options.repeat; r++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (!machine.call(function, test.arguments, result.value))
+			{
+				std::cerr << test.name << ": " << machine.error() << std::endl;
+				return 1;
+			}
+			auto middle = std::chrono::steady_clock::now();
+			expected = test.native(test.arguments);
+			auto end = std::chrono::steady_clock::now();
+			result.seconds = std::min(result.seconds, std::chrono::duration<double>(middle - start).count());
+			result.nativeSeconds = std::min(result.nativeSeconds, std::chrono::duration<double>(end - middle).count());
+		}
+		result.operations = test.operations(expected);
+		result.correct = result.value == expected;
+		failed |= !result.correct;
+
+		std::cout << std::left << std::setw(10) << test.name << std::right
+			<< std::setw(12) << result.operations / 1e6
+			<< std::setw(10) << result.nanosecondsPerOperation()
+			<< std::setw(12) << result.nativeNanosecondsPerOperation()
+			<< std::setw(10) << std::setprecision(1) << result.seconds / result.nativeSeconds << std::setprecision(2);
+		if (!result.correct)
+			std::cout << "  wrong result " << result.value << ", expected " << expected;
+		std::cout << std::endl;
+		results.push_back(result);
+	}
+
+	if (!options.json.empty())
+	{
+		std::ofstream out(options.json);
+		writeJson(out, options, results);
+		if (!out)
+		{
+			std::cerr << "Could not write " << options.json << std::endl;
+			return 1;
+		}
+	}
+
+	// A result that differs from the C++ one is a compiler or interpreter regression
+	return failed ? 1 : 0;
+}
@@ -1,26 +1,36 @@
 #include "lexer/lexer.hpp"
+#include "lexer/token_range.hpp"
 
-#include <fstream>
 #include <iostream>
+#include <string>
 
-int main()
+int main(int argc, char** argv)
 {
-	// Open scripts/script.tds
-	std::ifstream script("C:/Data/Acads/Programming/C++/threeD/examples/scripts/script.tds");
+	// Map scripts/script.tds, or the script given on the command line
+	std::string path = argc > 1 ? argv[1] : "C:/Data/Acads/Programming/C++/threeD/examples/scripts/script.tds";
+	threeD::Lexer::SourceManager sources;
+	auto script = sources.addFile(path);
 
 	// If script.tds could not be opened, exit
-	if (!script.is_open())
+	if (script == threeD::Lexer::InvalidFileId)
 	{
 		std::cout << "Could not open script.tds" << std::endl;
 		return 1;
 	}
 
 	// Create a lexer
-	threeD::Lexer::Lexer lexer(script, "C:/Data/Acads/Programming/C++/threeD/examples/scripts/script.tds");
+	threeD::Lexer::Lexer lexer(sources, script);
 
-	for (auto token = lexer.nextToken(); token.type != threeD::Lexer::TokenType::EOF_; token = lexer.nextToken())
+	for (const auto& token : threeD::Lexer::TokenRange(lexer))
 	{
 		// Print the token
-		std::cout << token.type << " " << token.lexeme << std::endl;
+		std::cout << token.type << " " << lexer.lexeme(token) << std::endl;
+	}
+
+	// Errors came out as ERROR tokens, print what went wrong
+	if (!lexer.diagnostics().empty())
+	{
+		lexer.diagnostics().print(std::cerr, sources);
+		return 1;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "diagnostic.hpp"
+#include "source_manager.hpp"
+#include "thread_pool.hpp"
+#include "token_stream.hpp"
+
+#include <string>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	// Tokens and errors of one file lexed by lexFiles
+	struct LexedFile {
+	public:
+		FileId file = InvalidFileId;		/* InvalidFileId if the file could not be opened */
+		TokenStream tokens;
+		DiagnosticEngine diagnostics;
+	};
+
+	// Lexes every file on the pool's workers, largest files first.
+	// results[i] belongs to files[i] whatever order the work ran in,
+	// so the output does not depend on the number of workers.
+	// Identifiers go into each file's own symbols, or all into symbols if given.
+	std::vector<LexedFile> lexFiles(SourceManager& sources, const std::vector<FileId>& files, ThreadPool& pool,
+		Recovery recovery = Recovery::NextCharacter, ConcurrentSymbolTable* symbols = nullptr);
+	// Same, mapping each path on the worker that lexes it
+	std::vector<LexedFile> lexFiles(SourceManager& sources, const std::vector<std::string>& paths, ThreadPool& pool,
+		Recovery recovery = Recovery::NextCharacter, ConcurrentSymbolTable* symbols = nullptr);
+
+	// Lexes one file on all of the pool's workers. The file is split into line aligned
+	// chunks of about chunkSize bytes (0 picks one), every chunk is lexed assuming it
+	// starts outside a block comment and chunks where that proves wrong are lexed again.
+	// Tokens and diagnostics equal those of one Lexer with the same recovery.
+	LexedFile lexChunked(SourceManager& sources, FileId file, ThreadPool& pool, Recovery recovery = Recovery::NextCharacter, size_t chunkSize = 0);
+
+	// Every .tds file under directory, sorted by path
+	std::vector<std::string> findScripts(const std::string& directory);
+
+}}
+
+#endif // __BATCH_H__
@@ -0,0 +1,60 @@
+#ifndef __DIAGNOSTIC_H__
+#define __DIAGNOSTIC_H__
+
+#include "token.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	class SourceManager;
+
+	// An error found while lexing a file
+	struct Diagnostic {
+	public:
+		FileId file;			/* InvalidFileId if the file could not be opened */
+		uint32_t offset;		/* Byte offset of the offending character, the file size at end of file */
+		std::string message;	/* eg. Unexpected character: '@' */
+	};
+
+	// What the lexer does after an error. Every mode but Stop turns the bytes
+	// it gives up on into an ERROR token and carries on from START.
+	enum class Recovery : uint8_t {
+		Stop,			/* The ERROR token is the last token of the file */
+		NextCharacter,	/* Resume at the offending byte, or after it if no token can start with it */
+		NextSpace,		/* Resume at the next whitespace */
+		NextLine,		/* Resume at the end of the line */
+	};
+
+	// Collects diagnostics without printing anything, reporting one is a push_back.
+	// Not thread safe, use one per lexer or per file.
+	class DiagnosticEngine
+	{
+	public:
+		void report(FileId file, uint32_t offset, std::string message) { diagnostics.push_back({file, offset, std::move(message)}); }
+		// Moves every diagnostic of other to the end of this one
+		void merge(DiagnosticEngine&& other);
+		void clear() { diagnostics.clear(); }
+		// Drops every diagnostic after the first size
+		void truncate(size_t size) { diagnostics.resize(std::min(size, diagnostics.size())); }
+
+		const std::vector<Diagnostic>& all() const { return diagnostics; }
+		size_t size() const { return diagnostics.size(); }
+		bool empty() const { return diagnostics.empty(); }
+
+		// file:line:column: error: message, then the line and a caret under the column
+		static std::string render(const Diagnostic& diagnostic, const SourceManager& sources);
+		// Renders every diagnostic, in the order they were reported
+		void print(std::ostream& out, const SourceManager& sources) const;
+
+	private:
+		std::vector<Diagnostic> diagnostics;
+	};
+
+}}
+
+#endif // __DIAGNOSTIC_H__
@@ -0,0 +1,63 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace threeD { namespace Lexer {
+
+	// Final mix of MurmurHash3
+	inline uint64_t mixHash(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDull;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	// 64-bit hash of bytes, eight at a time. Fast, not cryptographic.
+	inline uint64_t contentHash(std::string_view bytes)
+	{
+		constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+		uint64_t h = bytes.size() * multiplier;
+		auto p = bytes.data();
+		auto end = p + bytes.size();
+		for (; end - p >= 8; p += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, p, 8);
+			h = (h ^ word) * multiplier;
+			h ^= h >> 29;
+		}
+		// The last bytes are read with fixed size loads that may overlap bytes
+		// already hashed, a variable length copy would be a call to memcpy
+		auto rest = static_cast<size_t>(end - p);
+		if (rest > 0)
+		{
+			uint64_t word;
+			if (bytes.size() >= 8)
+			{
+				std::memcpy(&word, end - 8, 8);
+			}
+			else if (rest >= 4)
+			{
+				uint32_t first, last;
+				std::memcpy(&first, p, 4);
+				std::memcpy(&last, end - 4, 4);
+				word = first | uint64_t(last) << 32;
+			}
+			else
+			{
+				word = uint64_t(uint8_t(p[0])) | uint64_t(uint8_t(p[rest / 2])) << 8 | uint64_t(uint8_t(end[-1])) << 16;
+			}
+			h = (h ^ word) * multiplier;
+		}
+		return mixHash(h);
+	}
+
+}}
+
+#endif // __HASH_H__
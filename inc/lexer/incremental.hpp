@@ -0,0 +1,57 @@
+#ifndef __INCREMENTAL_H__
+#define __INCREMENTAL_H__
+
+#include "diagnostic.hpp"
+#include "source_manager.hpp"
+#include "token_stream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	// The bytes [offset, offset + removed) of the old text were replaced by inserted bytes
+	struct Edit {
+	public:
+		uint32_t offset;
+		uint32_t removed;
+		uint32_t inserted;
+	};
+
+	// Tokens [first, first + removed) of the old stream became [first, first + inserted)
+	struct TokenEdit {
+	public:
+		size_t first;
+		size_t removed;
+		size_t inserted;
+	};
+
+	/*
+	 * Brings stream, lexed from the text before edit, up to date with file,
+	 * the text after it. Only the tokens around the edit are lexed again.
+	 * Put the edited text in place with sources.replace(file, ...) first, a
+	 * file added anew for every edit would keep every old copy alive.
+	 *
+	 * Every token starts in the START state and only bytes before a token decide
+	 * where it starts, so lexing restarts exactly at the start of the last token
+	 * before the edit, block comments included. It stops at the first new token
+	 * past the edit that starts where an old token, shifted by the edit, started:
+	 * from there on both streams see the same bytes from the same state.
+	 *
+	 * Errors in the re-lexed region are added to diagnostics, recovery should be
+	 * the one the stream was lexed with. Diagnostics reported for the replaced
+	 * tokens are the caller's to drop, each lies within or at the end of one of
+	 * the ERROR tokens among them.
+	 *
+	 * The values of the new literals are appended to stream.literals, those of
+	 * the replaced tokens stay in it unused until the file is lexed whole again.
+	 * New identifiers are interned into symbols, the table the stream was
+	 * interned into, or stream.symbols if that is null.
+	 */
+	TokenEdit relex(SourceManager& sources, FileId file, TokenStream& stream, const Edit& edit,
+		DiagnosticEngine* diagnostics = nullptr, Recovery recovery = Recovery::NextCharacter, SymbolTable* symbols = nullptr);
+
+}}
+
+#endif // __INCREMENTAL_H__
@@ -0,0 +1,59 @@
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace threeD { namespace Lexer {
+
+	// Counters of where the lexer spends its time. Only builds configured with
+	// THREED_INSTRUMENT collect them, in other builds every count stays 0 and
+	// the lexer carries no extra code or state.
+	struct LexerStats {
+	public:
+	#ifdef THREED_INSTRUMENT
+		static constexpr bool enabled = true;
+	#else
+		static constexpr bool enabled = false;
+	#endif
+
+		static constexpr size_t stateCount = 17;						/* Lexer::LexerState */
+		static constexpr size_t typeCount = size_t(TokenType::COLON) + 1;	/* TokenType */
+		static constexpr uint32_t sampleEvery = 64;						/* One timed call in so many */
+
+		uint64_t stateBytes[stateCount] = {};				/* Bytes read in each state, scanned runs included */
+		uint64_t stateVisits[stateCount] = {};				/* Times each state handled a character */
+		uint64_t transitions[stateCount][stateCount] = {};	/* [from][to], a handler followed by a different one */
+		uint64_t tokens[typeCount] = {};
+		uint64_t tokenBytes[typeCount] = {};
+
+		// Sampled cycle counts (rdtsc, nanoseconds where there is none), timer overhead subtracted
+		uint64_t readSamples = 0;		/* getNextChar() */
+		uint64_t readCycles = 0;
+		uint64_t tokenSamples = 0;		/* nextToken(), from the call to the emitted token */
+		uint64_t tokenCycles = 0;
+
+		void merge(const LexerStats& other);
+		// Comment bytes are those read in the comment states, the opening // and /* included
+		uint64_t commentBytes() const;
+		uint64_t stringBytes() const { return tokenBytes[size_t(TokenType::STR_LITERAL)] + tokenBytes[size_t(TokenType::CHAR_LITERAL)]; }
+
+		// Human readable tables, states and token types that never occurred are left out
+		void print(std::ostream& out) const;
+
+		// Every Lexer adds its counts here when it is destroyed, thread safe
+		static void addToGlobal(const LexerStats& stats);
+		static LexerStats global();
+
+		// Timestamp the samples are taken with
+		static uint64_t now();
+		// Cost of two back to back now() calls, measured once
+		static uint64_t timerOverhead();
+	};
+
+}}
+
+#endif // __INSTRUMENT_H__
@@ -2,31 +2,27 @@
 #define __LEXER_H__
 
 #include "token.hpp"
+#include "diagnostic.hpp"
+#include "instrument.hpp"
+#include "literal.hpp"
+#include "source.hpp"
+#include "source_manager.hpp"
+#include "symbol.hpp"
+#include "token_stream.hpp"
 
+#include <memory>
 #include <string>
-#include <sstream>
+#include <string_view>
 #include <istream>
+#include <vector>
 
 namespace threeD { namespace Lexer {
 
+	namespace Scan { struct Kernels; }
+
 	class Lexer
 	{
 	public:
-		Lexer(std::istream& buffer, std::string filename = "<source>");
-		~Lexer() = default;
-		Token nextToken();
-		Token peekToken();
-
-	private:
-		std::istream& buffer;
-		Token nextTokenFound;
-		int line = 1;
-		int column = 0;
-		std::string lexeme;
-		std::string filename;
-		std::string curLineWhitespace;
-		std::stringstream curLineStream;
-
 		// Stores what has been seen so far
 		enum class LexerState
 		{
@@ -47,14 +43,148 @@ namespace threeD { namespace Lexer {
 			PUNCT,				/* Punctuation */
 			LINE_COMMENT,		/* eg. // This is a line comment */
 			BLOCK_COMMENT		/* eg. /* This is a block comment */
-		} state = LexerState::START;
+		};
+
+		// Lexes a file registered with sources
+		Lexer(SourceManager& sources, FileId file);
+		// Lexes only the bytes [begin, end) of file, entering in state.
+		// Token offsets stay relative to the whole file.
+		Lexer(SourceManager& sources, FileId file, uint32_t begin, uint32_t end, LexerState state);
+		// The constructors below register the source with a SourceManager of the
+		// lexer's own, freed with it, see sourceManager(). A source too large for
+		// it is reported to diagnostics() and lexes as empty.
+
+		// Compatibility path, reads the whole stream into memory up front
+		Lexer(std::istream& buffer, std::string filename = "<source>");
+		// Lexes the bytes in place, source must outlive every use of its tokens
+		Lexer(std::string_view source, std::string filename = "<source>");
+		// Lexes an owned or memory-mapped buffer, see SourceBuffer::fromFile
+		Lexer(SourceBuffer source, std::string filename = "<source>");
+#ifdef THREED_INSTRUMENT
+		~Lexer() { LexerStats::addToGlobal(counters); }
+#else
+		~Lexer() = default;
+#endif
+		Token nextToken();
+		// The token nextToken() returned last, see TokenLookahead to look further
+		Token peekToken();
+		// Lexes every remaining token into one struct-of-arrays stream, the
+		// literal values and the lexer's own symbols so far move into the stream with them
+		TokenStream tokenizeAll();
+		// Values of the literal tokens returned by nextToken(), see Token::value
+		const LiteralTable& literals() const { return literalTable; }
+
+		// The value of an IDENTIFIER token is its SymbolId, in the lexer's own
+		// table or in the one given to internInto(). Tables may be shared by
+		// lexers of several files, a ConcurrentSymbolTable by lexers on several threads.
+		void internInto(SymbolTable& table) { symbolSink = &table; }
+		void internInto(ConcurrentSymbolTable& table) { sharedSymbols = &table; }
+		// What IDENTIFIER values refer to, unless interning into a ConcurrentSymbolTable
+		const SymbolTable& symbols() const { return symbolSink ? *symbolSink : ownSymbols; }
+
+		// Errors never stop the process. Each one is reported to the lexer's own
+		// DiagnosticEngine, or to sink once reportTo() is called, and surfaces
+		// as an ERROR token; recovery decides where lexing picks up again.
+		void reportTo(DiagnosticEngine& sink) { this->sink = &sink; }
+		void setRecovery(Recovery recovery) { this->recovery = recovery; }
+		DiagnosticEngine& diagnostics() { return sink ? *sink : ownDiagnostics; }
+		const DiagnosticEngine& diagnostics() const { return sink ? *sink : ownDiagnostics; }
+
+		// View of the token's bytes, valid as long as the lexer
+		std::string_view lexeme(const Token& token) const;
+		// Line and column of a byte offset, from the file's line index
+		SourceLocation location(uint32_t offset) const;
+		// Copies the token's lexeme and file name out of the source buffer
+		OwningToken toOwning(const Token& token) const;
+
+		// State after the last character read, START or BLOCK_COMMENT at the start of a line
+		LexerState currentState() const { return state; }
+
+		// Where the lexer is, a handful of pointers and flags
+		struct Checkpoint
+		{
+			const char* cur;
+			const char* charPos;
+			const char* tokenStart;
+			const char* stringRun;
+			Token lastToken;
+			const DiagnosticEngine* engine;	/* diagnostics() when it was taken */
+			size_t diagnostics;				/* Its size then */
+			LexerState state;
+			uint8_t punctState;
+			bool hexDigits;
+		};
+
+		Checkpoint checkpoint() const;
+		// Puts the lexer back where checkpoint() was taken, in O(1): the same tokens
+		// follow and the diagnostics reported since are dropped. Literals and symbols
+		// keep their tables, a literal lexed again is stored again under a new index.
+		// Dropping means truncating diagnostics() to its size at checkpoint(), so
+		// reportTo() may not change it in between and no one else may report to
+		// that engine meanwhile, their diagnostics would go too.
+		void restore(const Checkpoint& checkpoint);
+		FileId file() const { return fileId; }
+		SourceManager& sourceManager() const { return *sources; }
+
+		// What this lexer has counted so far, all zero without THREED_INSTRUMENT
+#ifdef THREED_INSTRUMENT
+		const LexerStats& stats() const { return counters; }
+#else
+		const LexerStats& stats() const { static const LexerStats none; return none; }
+#endif
+
+	private:
+		// rejected collects why addBuffer() refused source, if it did
+		Lexer(std::unique_ptr<SourceManager> owned, SourceBuffer source, std::string filename, DiagnosticEngine rejected = {});
+
+		std::unique_ptr<SourceManager> ownSources;		/* Only for the compatibility constructors */
+		SourceManager* sources;
+		FileId fileId;
+		std::string_view source;
+		const char* cur;
+		const char* end;
+		const char* charPos;		/* Position of the last character read */
+		const char* tokenStart;		/* Position of the first character of the current token */
+		const char* stringRun = nullptr;	/* Start of the string literal bytes not decoded yet */
+		uint8_t punctState = 0;		/* Operator DFA state while in PUNCT */
+		bool hexDigits = false;		/* The int literal being read started with 0x */
+		Token nextTokenFound = {};
+		const Scan::Kernels* scan;
+		LiteralTable literalTable;
+		SymbolTable ownSymbols;			/* Also caches the ids in sharedSymbols */
+		SymbolTable* symbolSink = nullptr;
+		ConcurrentSymbolTable* sharedSymbols = nullptr;
+		std::vector<SymbolId> sharedIds;	/* Id in sharedSymbols of each symbol of ownSymbols */
+		DiagnosticEngine ownDiagnostics;
+		DiagnosticEngine* sink = nullptr;
+		Recovery recovery = Recovery::NextCharacter;
+
+		LexerState state = LexerState::START;
+
+#ifdef THREED_INSTRUMENT
+		LexerStats counters;
+		LexerState lastVisited = LexerState::START;
+		uint32_t readClock = 0;
+		uint32_t tokenClock = 0;
+		void visit(LexerState visited);
+		Token lexToken();
+#endif
 
 		template<LexerState state_>
-		bool handleState(char nextChar);
+		bool handleState(int nextChar);
 
-		char getNextChar();
+		int getNextChar();		/* Next byte as 0-255, or EOF */
+		void skipTo(const char* runEnd);
+		void emit(TokenType type, const char* tokenEnd);
+		bool unexpectedCharacter(int nextChar);
+		bool emitLiteral(TokenType type, const char* tokenEnd);
+		void emitWord(const char* tokenEnd);
+		bool literalError(const char* at, std::string message);
 	};	
 
+	// Lexes a whole file registered with sources
+	TokenStream tokenizeAll(SourceManager& sources, FileId file);
+
 }}
 
 #endif // __LEXER_H__
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef __LINE_INDEX_H__
+#define __LINE_INDEX_H__
+
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	// Byte offset of the start of every line of a source, built with one
+	// vectorized newline scan. Turns offsets into lines and columns on demand.
+	class LineIndex
+	{
+	public:
+		LineIndex() = default;
+		explicit LineIndex(std::string_view source);
+
+		// 1-based line and column of offset, O(log lines)
+		SourceLocation location(uint32_t offset) const;
+		// Text of a 1-based line, without its newline
+		std::string_view lineText(int line) const;
+		uint32_t lineStart(int line) const { return starts[line - 1]; }
+		size_t lineCount() const { return starts.size(); }
+
+	private:
+		std::string_view source;
+		std::vector<uint32_t> starts = {0};
+	};
+
+}}
+
+#endif // __LINE_INDEX_H__
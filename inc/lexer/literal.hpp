@@ -0,0 +1,77 @@
+#ifndef __LITERAL_H__
+#define __LITERAL_H__
+
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	/*
+	 * Decoded values of literal tokens, filled by the lexer as it emits them.
+	 * Token::value says where to look:
+	 *	INT_LITERAL		index of integer()
+	 *	FLOAT_LITERAL	index of floating()
+	 *	STR_LITERAL		index of string(), escapes decoded
+	 *	CHAR_LITERAL	the character itself, escapes decoded
+	 *	BOOL_LITERAL	1 for true, 0 for false
+	 *	IDENTIFIER		SymbolId, see Lexer::internInto()
+	 * and is 0 for every other token.
+	 */
+	class LiteralTable
+	{
+	public:
+		uint32_t addInteger(uint64_t value);
+		uint32_t addFloat(double value);
+
+		// Strings are built a piece at a time as the lexer scans them. Beginning
+		// a string drops whatever a string that was never ended left behind.
+		void beginString() { arena.resize(stringStarts.back()); }
+		void appendString(const char* first, const char* last) { arena.append(first, last); }
+		void appendString(char c) { arena += c; }
+		uint32_t endString();
+
+		uint64_t integer(uint32_t index) const { return integers[index]; }
+		double floating(uint32_t index) const { return floats[index]; }
+		// Valid until the next string is begun or a table appended
+		std::string_view string(uint32_t index) const
+		{
+			return std::string_view(arena).substr(stringStarts[index], stringStarts[index + 1] - stringStarts[index]);
+		}
+
+		size_t integerCount() const { return integers.size(); }
+		size_t floatCount() const { return floats.size(); }
+		size_t stringCount() const { return stringStarts.size() - 1; }
+		void clear();
+
+		// Where the values of another table start once appended to this one
+		struct Bases
+		{
+			uint32_t integers;
+			uint32_t floats;
+			uint32_t strings;
+		};
+
+		Bases append(const LiteralTable& other);
+		// Value of a token of the appended table, as an index into this one
+		static uint32_t rebase(TokenType type, uint32_t value, const Bases& bases);
+
+		// The character an escape stands for, eg. 'n' gives '\n'
+		static char unescape(char escape);
+
+	private:
+		friend class TokenCache;
+
+		std::vector<uint64_t> integers;
+		std::vector<double> floats;
+		std::vector<uint32_t> stringStarts = {0};	/* String i is arena[stringStarts[i], stringStarts[i + 1]) */
+		std::string arena;
+	};
+
+}}
+
+#endif // __LITERAL_H__
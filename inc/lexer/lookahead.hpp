@@ -0,0 +1,93 @@
+#ifndef __LOOKAHEAD_H__
+#define __LOOKAHEAD_H__
+
+#include "lexer.hpp"
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	/*
+	 * Tokens of a Lexer with lookahead and backtracking, for parsers.
+	 *
+	 * Tokens are lexed into a ring of capacity slots as peek() asks for them and
+	 * stay there until consumed, so peek(k) for any k below capacity costs one
+	 * lexed token at most. A mark pins every token from its position on: rewind()
+	 * moves back to it without lexing anything again. Marks nest and are released
+	 * in reverse order. The ring only grows when a mark pins more than capacity
+	 * tokens or peek() reaches further, any other use allocates nothing after
+	 * construction.
+	 */
+	class TokenLookahead
+	{
+	public:
+		// Position in the token sequence, from mark()
+		struct Mark
+		{
+			uint64_t index;
+		};
+
+		// capacity is rounded up to a power of two
+		explicit TokenLookahead(Lexer& lexer, size_t capacity = 64);
+		TokenLookahead(const TokenLookahead&) = delete;
+		TokenLookahead& operator=(const TokenLookahead&) = delete;
+
+		// The token k places after the next one, EOF_ past the end of the input
+		Token peek(size_t k = 0)
+		{
+			if (lexed <= read + k)
+				fill(read + k);
+			return slots[(read + k) & mask].token(from->file());
+		}
+
+		Token next()
+		{
+			auto token = peek();
+			read++;
+			return token;
+		}
+
+		// Skips count tokens
+		void skip(size_t count) { peek(count); read += count; }
+
+		Mark mark();
+		// Back to the token that was next when m was taken. m stays live.
+		void rewind(Mark m);
+		// Unpins the tokens of the last mark taken, which m must be
+		void release(Mark m);
+
+		// Tokens consumed so far
+		uint64_t position() const { return read; }
+		size_t capacity() const { return slots.size(); }
+		Lexer& lexer() const { return *from; }
+
+	private:
+		// Token without its file, every token of the ring has the lexer's
+		struct Slot
+		{
+			uint32_t offset;
+			uint32_t length;
+			uint32_t value;
+			TokenType type;
+
+			Token token(FileId file) const { return {type, file, offset, length, value}; }
+		};
+
+		void fill(uint64_t index);
+		void grow(uint64_t keep);
+
+		Lexer* from;
+		std::vector<Slot> slots;
+		uint64_t mask;
+		uint64_t read = 0;			/* Index of the next token next() returns */
+		uint64_t lexed = 0;			/* Tokens lexed into the ring so far */
+		uint64_t pinned = 0;		/* Index of the first mark while marks > 0 */
+		size_t marks = 0;
+	};
+
+}}
+
+#endif // __LOOKAHEAD_H__
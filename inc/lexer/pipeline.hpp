@@ -0,0 +1,96 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "lexer.hpp"
+#include "spsc_queue.hpp"
+#include "token.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <thread>
+
+namespace threeD { namespace Lexer {
+
+	/*
+	 * Runs a Lexer on a thread of its own while the caller consumes its tokens,
+	 * so lexing overlaps with whatever the consumer does with them. Tokens
+	 * travel in batches through a bounded SpscQueue: the lexer thread waits
+	 * when the consumer is queueBatches behind (backpressure) and the consumer
+	 * waits when it catches up with the lexer.
+	 *
+	 * The Lexer belongs to the lexer thread from construction until next()
+	 * returns EOF_. Configure it (recovery, reportTo, internInto) before, and
+	 * read its diagnostics, literals and symbols only after. Until then token
+	 * values can be compared, two identifiers with the same value spell the
+	 * same name, but not resolved.
+	 */
+	class PipelinedLexer
+	{
+	public:
+		explicit PipelinedLexer(Lexer& lexer, size_t queueBatches = 16);
+		// Stops the lexer thread if the stream was not drained
+		~PipelinedLexer();
+		PipelinedLexer(const PipelinedLexer&) = delete;
+		PipelinedLexer& operator=(const PipelinedLexer&) = delete;
+
+		// EOF_ once the input is exhausted, and on every call after. Rethrows,
+		// once, what the lexer thread threw, after the tokens lexed before it.
+		Token next()
+		{
+			if (position < current->count)
+				return current->tokens[position++].token(file);
+			return advance();
+		}
+
+		// True once the last batch arrived, the Lexer is the caller's again
+		bool done() const { return finished; }
+
+		// Times the lexer thread found the queue full and the consumer found it
+		// empty, the first is only complete once done()
+		uint64_t producerWaits() const { return fullWaits; }
+		uint64_t consumerWaits() const { return emptyWaits; }
+
+		static constexpr size_t batchTokens = 256;
+
+	private:
+		// Token without its file, every token of a batch has the lexer's
+		struct Entry
+		{
+			uint32_t offset;
+			uint32_t length;
+			uint32_t value;
+			TokenType type;
+
+			Token token(FileId file) const { return {type, file, offset, length, value}; }
+		};
+
+		struct Batch
+		{
+			uint32_t count = 0;
+			bool last = false;		/* Ends with EOF_, or where the lexer thread threw */
+			Entry tokens[batchTokens];
+		};
+
+		Token advance();
+		void produce();
+		Batch* waitForSpace();
+
+		Lexer& lexer;
+		FileId file;
+		SpscQueue<Batch> queue;
+		Batch empty;					/* current before the first batch arrives */
+		Batch* current = &empty;
+		uint32_t position = 0;
+		bool finished = false;
+		uint64_t emptyWaits = 0;
+		uint64_t fullWaits = 0;			/* Written by the lexer thread, read once it is joined */
+		std::exception_ptr error;		/* Published with the last batch */
+		std::atomic<bool> stopping{false};
+		std::thread worker;				/* Last, starts once everything above is built */
+	};
+
+}}
+
+#endif // __PIPELINE_H__
@@ -0,0 +1,49 @@
+#ifndef __SOURCE_H__
+#define __SOURCE_H__
+
+#include <string>
+#include <string_view>
+#include <istream>
+
+namespace threeD { namespace Lexer {
+
+	// Contiguous, read-only view of a source file.
+	// The bytes are either borrowed (string_view), owned (read from a stream)
+	// or memory-mapped from disk, but are always walked through a raw pointer.
+	class SourceBuffer
+	{
+	public:
+		SourceBuffer() = default;
+		// Borrows the bytes, the caller must keep them alive
+		explicit SourceBuffer(std::string_view view);
+		SourceBuffer(SourceBuffer&& other) noexcept;
+		SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+		SourceBuffer(const SourceBuffer&) = delete;
+		SourceBuffer& operator=(const SourceBuffer&) = delete;
+		~SourceBuffer();
+
+		// Maps the file at path into memory, isOpen() is false on failure
+		static SourceBuffer fromFile(const std::string& path);
+		// Reads the remainder of the stream into an owned buffer
+		static SourceBuffer fromStream(std::istream& stream);
+		// Takes ownership of contents
+		static SourceBuffer fromString(std::string contents);
+
+		bool isOpen() const { return open; }
+		const char* data() const { return view_.data(); }
+		size_t size() const { return view_.size(); }
+		std::string_view view() const { return view_; }
+
+	private:
+		void release();
+
+		std::string_view view_;
+		std::string owned;
+		void* mapping = nullptr;
+		size_t mappingSize = 0;
+		bool open = true;
+	};
+
+}}
+
+#endif // __SOURCE_H__
@@ -0,0 +1,85 @@
+#ifndef __SOURCE_MANAGER_H__
+#define __SOURCE_MANAGER_H__
+
+#include "token.hpp"
+#include "diagnostic.hpp"
+#include "source.hpp"
+#include "line_index.hpp"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace threeD { namespace Lexer {
+
+	// Registry of every source file, tokens refer to files by FileId.
+	// All members are safe to call from multiple threads; views returned
+	// stay valid for the lifetime of the SourceManager, or until replace().
+	class SourceManager
+	{
+	public:
+		SourceManager() = default;
+		SourceManager(const SourceManager&) = delete;
+		SourceManager& operator=(const SourceManager&) = delete;
+
+		// Token offsets are 32 bits, a file must fit in them
+		static constexpr size_t maxFileSize = UINT32_MAX;
+		// Tokens keep file ids in fileIdBits, the largest one means none
+		static constexpr size_t maxFiles = InvalidFileId;
+
+		// Maps the file at path, a path registered twice returns the same id.
+		// Returns InvalidFileId if the file could not be opened, is larger than
+		// maxFileSize or maxFiles are registered, and says why to diagnostics if given.
+		FileId addFile(const std::string& path, DiagnosticEngine* diagnostics = nullptr);
+		// Registers a buffer under name, every call gets a new id.
+		// Rejects buffers like addFile.
+		FileId addBuffer(std::string name, SourceBuffer buffer, DiagnosticEngine* diagnostics = nullptr);
+		// Swaps the contents of file for buffer, keeping its id and name, e.g. for
+		// the edited text of a file being relexed. Views of the old contents and
+		// its line index dangle, no other thread may still be using them.
+		// Returns false and keeps the old contents if buffer is too large.
+		bool replace(FileId file, SourceBuffer buffer, DiagnosticEngine* diagnostics = nullptr);
+
+		std::string_view name(FileId file) const;
+		std::string_view contents(FileId file) const;
+		std::string_view lexeme(const Token& token) const;
+		// Line index of file, built on first use
+		const LineIndex& lines(FileId file) const;
+		// Line and column of a byte offset, built on the line index
+		SourceLocation location(FileId file, uint32_t offset) const;
+		size_t fileCount() const;
+
+		// Shared instance for callers without a manager of their own. Files are
+		// never removed, so it is no place for sources of a long running process.
+		static SourceManager& global();
+
+	private:
+		struct Lines
+		{
+			std::once_flag built;
+			LineIndex index;
+		};
+
+		struct File
+		{
+			std::string name;
+			SourceBuffer buffer;
+			std::unique_ptr<Lines> lines;	/* Heap allocated, once_flag cannot move */
+		};
+
+		const File& get(FileId file) const;
+		// Appends a file under the write lock, InvalidFileId once maxFiles are registered
+		FileId append(std::string name, SourceBuffer buffer, DiagnosticEngine* diagnostics);
+
+		mutable std::shared_mutex mutex;
+		std::deque<File> files;		/* deque, so references survive push_back */
+		std::unordered_map<std::string, FileId> pathToFile;
+	};
+
+}}
+
+#endif // __SOURCE_MANAGER_H__
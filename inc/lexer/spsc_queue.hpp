@@ -0,0 +1,94 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	/*
+	 * Bounded lock-free queue between exactly one producer thread and one
+	 * consumer thread. Elements are written and read in place: the producer
+	 * fills back() and publishes it with push(), the consumer reads front()
+	 * and hands the slot back with pop(), so large elements are never copied.
+	 *
+	 * Each side keeps a cached copy of the other side's index and only loads
+	 * the shared one when the cache says the queue is full or empty, which
+	 * keeps the two cache lines from bouncing on every element.
+	 */
+	template <typename T>
+	class SpscQueue
+	{
+	public:
+		// capacity is rounded up to a power of two
+		explicit SpscQueue(size_t capacity)
+		{
+			size_t size = 2;
+			while (size < capacity)
+				size *= 2;
+			slots.resize(size);
+			mask = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer: the slot to fill next, nullptr while the queue is full
+		T* back()
+		{
+			auto tail = producer.index.load(std::memory_order_relaxed);
+			if (tail - producer.cached == slots.size())
+			{
+				producer.cached = consumer.index.load(std::memory_order_acquire);
+				if (tail - producer.cached == slots.size())
+					return nullptr;
+			}
+			return &slots[tail & mask];
+		}
+
+		// Producer: publishes the slot back() returned
+		void push()
+		{
+			producer.index.store(producer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Consumer: the oldest published slot, nullptr while the queue is empty
+		T* front()
+		{
+			auto head = consumer.index.load(std::memory_order_relaxed);
+			if (head == consumer.cached)
+			{
+				consumer.cached = producer.index.load(std::memory_order_acquire);
+				if (head == consumer.cached)
+					return nullptr;
+			}
+			return &slots[head & mask];
+		}
+
+		// Consumer: hands the slot front() returned back to the producer
+		void pop()
+		{
+			consumer.index.store(consumer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		size_t capacity() const { return slots.size(); }
+
+	private:
+		// One side's index and its copy of the other's, alone on a cache line
+		struct alignas(64) Side
+		{
+			std::atomic<uint64_t> index{0};
+			uint64_t cached = 0;
+		};
+
+		Side producer;
+		Side consumer;
+		std::vector<T> slots;
+		uint64_t mask;
+	};
+
+}}
+
+#endif // __SPSC_QUEUE_H__
@@ -0,0 +1,117 @@
+#ifndef __STREAM_LEXER_H__
+#define __STREAM_LEXER_H__
+
+#include "diagnostic.hpp"
+#include "lexer.hpp"
+#include "source_manager.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace threeD { namespace Lexer {
+
+	// Token of a StreamLexer, the stream itself is never kept whole
+	struct StreamToken {
+	public:
+		TokenType type;
+		uint64_t offset;			/* From the first byte of the stream */
+		std::string_view lexeme;	/* Points into the stream buffer, valid until the callback returns */
+		uint32_t value;				/* Decoded literal, or SymbolId, see StreamLexer::internInto() */
+		const LiteralTable* literals;	/* What literal values refer to, valid until the callback returns */
+	};
+
+	/*
+	 * Lexes input that arrives in pieces, from a pipe, a socket or feed(), in
+	 * at most capacity bytes of memory however long its lines or the stream are.
+	 *
+	 * Bytes go into one fixed buffer. After every read the bytes not yet
+	 * lexed are lexed and each complete token goes to the callback at once.
+	 * A token that reaches the end of the data read so far may still grow, it
+	 * is lexed again from its first byte once more data arrives. Every token
+	 * starts in START, so that is where lexing picks up; inside a comment no
+	 * token is pending and lexing picks up in the comment. Consumed bytes are
+	 * dropped by moving the pending ones to the front of the buffer.
+	 *
+	 * A token longer than capacity becomes an ERROR token of its first
+	 * capacity bytes, and the rest of its line is skipped.
+	 *
+	 * Diagnostics are kept up to a limit, see limitDiagnostics(), so garbage
+	 * input cannot grow memory past it either; the ones beyond are counted.
+	 */
+	class StreamLexer
+	{
+	public:
+		using Callback = std::function<void(const StreamToken&)>;
+
+		explicit StreamLexer(Callback onToken, size_t capacity = 1 << 16, std::string name = "<stream>");
+		StreamLexer(const StreamLexer&) = delete;
+		StreamLexer& operator=(const StreamLexer&) = delete;
+
+		void setRecovery(Recovery recovery) { this->recovery = recovery; }
+		// Interns the name of every IDENTIFIER delivered into table, and makes
+		// its value the SymbolId there. The table grows with every distinct
+		// name and is outside the capacity bound, so keep it to streams of a
+		// bounded vocabulary. Without it the value of an IDENTIFIER is InvalidSymbolId.
+		void internInto(SymbolTable& table) { symbolSink = &table; }
+		// Messages start with name:line:column, the stream is gone by the time they are printed
+		DiagnosticEngine& diagnostics() { return found; }
+		// Keeps at most limit diagnostics, those after are only counted
+		void limitDiagnostics(size_t limit) { diagnosticLimit = limit; }
+		// Diagnostics reported past the limit and not kept
+		uint64_t diagnosticsDropped() const { return dropped; }
+
+		// Lexes size more bytes of the stream
+		void feed(const char* data, size_t size);
+		// Lexes what is left, after it neither feed() nor finish() may be called
+		void finish();
+		// Feeds everything read() returns until end of file, then finishes.
+		// A read error is reported and ends the stream.
+		void lex(int fd);
+
+		uint64_t bytes() const { return base + filled; }
+		uint64_t tokens() const { return delivered; }
+		// True once Recovery::Stop ended lexing at an error
+		bool stopped() const { return halted; }
+
+	private:
+		void makeRoom();
+		void advance(size_t size);
+		void lexWindow(bool last);
+		void tooLong();
+		void drop(size_t size);
+		void report(size_t at, const std::string& message);
+		void deliver(const Token& token, const LiteralTable* literals, const SymbolTable* names);
+
+		Callback onToken;
+		std::unique_ptr<char[]> buffer;
+		size_t capacity;
+		std::string name;
+		SourceManager sources;		/* Holds only the buffer, lexed through a range Lexer */
+		FileId file;
+
+		size_t begin = 0;			/* First byte not lexed yet */
+		size_t filled = 0;			/* Bytes in the buffer */
+		uint64_t base = 0;			/* Stream offset of buffer[0] */
+		Lexer::LexerState entry = Lexer::LexerState::START;
+
+		uint64_t line = 1;			/* Line of buffer[0] */
+		uint64_t lineStart = 0;		/* Stream offset of the start of that line */
+
+		uint64_t delivered = 0;
+		SymbolTable* symbolSink = nullptr;
+		DiagnosticEngine found;
+		size_t diagnosticLimit = 1000;
+		uint64_t dropped = 0;
+		Recovery recovery = Recovery::NextCharacter;
+		bool skippingLine = false;	/* After a token that did not fit */
+		bool halted = false;
+		bool finished = false;
+	};
+
+}}
+
+#endif // __STREAM_LEXER_H__
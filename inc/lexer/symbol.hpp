@@ -0,0 +1,111 @@
+#ifndef __SYMBOL_H__
+#define __SYMBOL_H__
+
+#include "hash.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	class TokenCache;
+
+	// Interned identifier, two tokens spell the same name if their ids are equal
+	using SymbolId = uint32_t;
+	constexpr SymbolId InvalidSymbolId = UINT32_MAX;
+
+	/*
+	 * Every distinct identifier once, numbered from 0 in the order they were
+	 * first interned. Names are stored back to back in one arena and found
+	 * through an open addressing table of their hashes, so interning a name
+	 * seen before costs a hash, usually one probe and one compare.
+	 *
+	 * Not thread safe, see ConcurrentSymbolTable.
+	 */
+	class SymbolTable
+	{
+	public:
+		SymbolId intern(std::string_view name) { return intern(name, contentHash(name)); }
+		// hash must be contentHash(name)
+		SymbolId intern(std::string_view name, uint64_t hash);
+		// InvalidSymbolId if name was never interned
+		SymbolId find(std::string_view name) const;
+
+		// Valid until the next intern
+		std::string_view name(SymbolId id) const { return std::string_view(arena).substr(starts[id], starts[id + 1] - starts[id]); }
+		uint64_t hash(SymbolId id) const { return hashes[id]; }
+		size_t size() const { return hashes.size(); }
+		bool empty() const { return hashes.empty(); }
+		void clear();
+
+		// Interns every name of other, result[i] is the id here of other's symbol i
+		std::vector<SymbolId> append(const SymbolTable& other);
+
+	private:
+		friend class TokenCache;		/* Stores and loads the arrays below as they are */
+
+		void grow();
+		bool spells(SymbolId id, std::string_view name) const
+		{
+			return starts[id + 1] - starts[id] == name.size() && std::memcmp(arena.data() + starts[id], name.data(), name.size()) == 0;
+		}
+
+		struct Slot
+		{
+			uint32_t hash;		/* Low bits of the full hash, saves most compares */
+			SymbolId id;		/* InvalidSymbolId if empty */
+		};
+
+		std::vector<Slot> slots;				/* Power of two, at most half full */
+		std::vector<uint64_t> hashes;			/* Of each symbol, for growing without rehashing */
+		std::vector<uint32_t> starts = {0};		/* Symbol i is arena[starts[i], starts[i + 1]) */
+		std::string arena;
+	};
+
+	/*
+	 * SymbolTable that many lexers intern into at once, for lexing files on
+	 * several threads with ids that compare across all of them. Symbols are
+	 * spread over shards by hash, each with its own lock. A Lexer only takes
+	 * a lock the first time it meets a name, see Lexer::internInto().
+	 *
+	 * Ids are not dense and depend on the order threads got to the locks.
+	 */
+	class ConcurrentSymbolTable
+	{
+	public:
+		ConcurrentSymbolTable() = default;
+		ConcurrentSymbolTable(const ConcurrentSymbolTable&) = delete;
+		ConcurrentSymbolTable& operator=(const ConcurrentSymbolTable&) = delete;
+
+		SymbolId intern(std::string_view name) { return intern(name, contentHash(name)); }
+		// Thread safe, hash must be contentHash(name)
+		SymbolId intern(std::string_view name, uint64_t hash);
+
+		// Thread safe, the copy stays valid however many names are interned
+		std::string name(SymbolId id) const;
+		size_t size() const;
+
+	private:
+		static constexpr unsigned shardBits = 5;
+
+		// The high bits of the hash pick the shard, the low ones the slot within it
+		static size_t shardOf(uint64_t hash) { return static_cast<size_t>(hash >> (64 - shardBits)); }
+
+		struct alignas(64) Shard
+		{
+			mutable std::mutex mutex;
+			SymbolTable table;
+		};
+
+		std::array<Shard, size_t(1) << shardBits> shards;
+	};
+
+}}
+
+#endif // __SYMBOL_H__
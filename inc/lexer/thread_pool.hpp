@@ -0,0 +1,67 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	// Fixed set of workers with one work queue each. A worker takes from the
+	// front of its own queue and, once that is empty, steals from the back of
+	// the others, so a worker stuck on a large item does not hold up the rest.
+	class ThreadPool
+	{
+	public:
+		// 0 uses one worker per hardware thread. The calling thread of run()
+		// is one of the workers, so ThreadPool(1) starts no threads.
+		explicit ThreadPool(unsigned workers = 0);
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		unsigned size() const { return static_cast<unsigned>(queues.size()); }
+
+		// Calls task(item) once for every item and returns when all calls have
+		// finished. Items are dealt out round-robin in the order given, put the
+		// most expensive ones first. Not reentrant, task must not call run().
+		// If a call throws, no further items are started and run() rethrows
+		// the first exception once the calls already running have returned.
+		void run(const std::vector<size_t>& items, const std::function<void(size_t)>& task);
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<size_t> items;
+		};
+
+		bool take(unsigned worker, size_t& item);
+		void drain(unsigned worker);
+		void workerLoop(unsigned worker);
+
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable wake;		/* A new run() started, or the pool is stopping */
+		std::condition_variable finished;	/* The last busy worker ran out of items */
+		const std::function<void(size_t)>* task = nullptr;
+		uint64_t generation = 0;
+		unsigned busy = 0;
+		bool stopping = false;
+		std::exception_ptr error;			/* First exception a task threw this run, under mutex */
+		std::atomic<bool> failed{false};	/* Set with error, stops handing out items */
+	};
+
+}}
+
+#endif // __THREAD_POOL_H__
@@ -1,15 +1,26 @@
 #ifndef __TOKEN_H__
 #define __TOKEN_H__
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <ostream>
 
 namespace threeD { namespace Lexer {
 	
-	enum class TokenType {
+	// Identifies a source file registered with a SourceManager. Tokens keep
+	// it in 24 bits, next to their type, see SourceManager::maxFiles
+	using FileId = uint32_t;
+	constexpr unsigned fileIdBits = 24;
+	constexpr FileId InvalidFileId = (FileId(1) << fileIdBits) - 1;
+
+	enum class TokenType : uint8_t {
 		// EOF_ is a special token type that is used to indicate the end of the file
 		EOF_,
 
+		// ERROR covers bytes the lexer could not make a token of, see DiagnosticEngine
+		ERROR,
+
 		// IDENTIFIER is a token type that is used to represent identifiers
 		IDENTIFIER, 	/* eg. answerToLifeUniverseAndEverything */
 
@@ -73,15 +84,36 @@ namespace threeD { namespace Lexer {
 
 	std::ostream& operator<<(std::ostream& out, const TokenType& type);
 
+	// 1-based position in a source file
+	struct SourceLocation {
+		int line;
+		int column;
+	};
+
+	// Compact token, the lexeme is a byte range of the source buffer
 	struct Token {
+	public:
+		TokenType type : 8;
+		FileId file : fileIdBits;	/* Shares a word with type, four tokens to a cache line */
+		uint32_t offset;
+		uint32_t length;
+		uint32_t value;		/* Decoded literal or SymbolId, see LiteralTable */
+
+		std::string_view lexeme(std::string_view source) const { return source.substr(offset, length); }
+	};
+
+	static_assert(sizeof(Token) == 16, "Token should stay compact");
+
+	// Self-contained copy of a token, see Lexer::toOwning
+	struct OwningToken {
 	public:
 		TokenType type;
 		std::string lexeme;
 		std::string file;
 		int line;
 		int column;
-		Token() = default;
-		Token(TokenType type, std::string lexeme, std::string file, int line, int column)
+		OwningToken() = default;
+		OwningToken(TokenType type, std::string lexeme, std::string file, int line, int column)
 			: type(type), lexeme(lexeme), file(file), line(line), column(column) {}
 
 	};
@@ -0,0 +1,108 @@
+#ifndef __TOKEN_CACHE_H__
+#define __TOKEN_CACHE_H__
+
+#include "diagnostic.hpp"
+#include "hash.hpp"
+#include "source.hpp"
+#include "source_manager.hpp"
+#include "token_stream.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace threeD { namespace Lexer {
+
+	// Bump whenever a change to the lexer changes the tokens or diagnostics of
+	// any input, every cache entry written before then stops matching
+	constexpr uint32_t lexerVersion = 3;
+
+	// Tokens of one file, mapped from the cache or freshly lexed
+	struct CachedTokens {
+	public:
+		TokenStreamView tokens;
+		DiagnosticEngine diagnostics;
+		bool hit = false;
+
+	private:
+		friend class TokenCache;
+		SourceBuffer mapping;		/* The cache entry, on a hit */
+		TokenStream owned;			/* The lexed tokens, on a miss */
+		std::unique_ptr<LiteralTable> literals;		/* On the heap, tokens.literals must survive moves */
+		std::unique_ptr<SymbolTable> symbols;
+	};
+
+	/*
+	 * Token streams on disk, one file per distinct source text. Entries are
+	 * named after the hash of the source, the lexer version and the recovery
+	 * mode, so renamed or copied scripts hit as well and a new lexer misses.
+	 *
+	 * An entry is a header, the offsets, lengths, values and types as the
+	 * arrays of a TokenStream, the arrays of the literal and symbol tables as
+	 * they are laid out in memory, then the diagnostics. A hit maps the entry
+	 * and points a TokenStreamView at the token arrays, nothing is parsed or
+	 * lexed. The tables must be able to grow, so they are copied out with one
+	 * memcpy per array rather than mapped, symbols keep their hash table and
+	 * are not interned again; the diagnostics are read one by one. Every token
+	 * is checked to lie within the source and to refer to a value its table
+	 * has, one read-only pass over the arrays, so a corrupt entry is a miss
+	 * rather than an out of bounds read.
+	 *
+	 * Entries are written to a temporary file and renamed into place, so
+	 * several threads or processes may share a directory. Using an entry
+	 * touches its modification time, and once the directory outgrows budget
+	 * bytes the least recently used entries are deleted.
+	 */
+	class TokenCache
+	{
+	public:
+		struct Stats
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t stores = 0;		/* Misses written to disk */
+			uint64_t evictions = 0;
+			uint64_t bytesEvicted = 0;
+		};
+
+		// Creates directory if needed
+		explicit TokenCache(std::string directory, uint64_t budget = uint64_t(256) << 20);
+		TokenCache(const TokenCache&) = delete;
+		TokenCache& operator=(const TokenCache&) = delete;
+
+		// Tokens of file from the cache, lexed and stored on a miss. Thread safe.
+		CachedTokens get(SourceManager& sources, FileId file, Recovery recovery = Recovery::NextCharacter);
+
+		// Deletes the least recently used entries until the directory fits budget
+		void evict();
+
+		Stats stats() const;
+		uint64_t diskUsage() const;
+		const std::string& directory() const { return root; }
+
+	private:
+		std::string entryPath(uint64_t key) const;
+		bool load(const std::string& path, uint64_t hash, std::string_view source, Recovery recovery, FileId file, CachedTokens& result);
+		uint64_t store(const std::string& path, uint64_t hash, std::string_view source, Recovery recovery, const TokenStream& tokens, const DiagnosticEngine& diagnostics);
+
+		std::string root;
+		uint64_t budget;
+
+		mutable std::mutex mutex;		/* Guards usage and eviction */
+		uint64_t usage = 0;				/* Bytes of entries, as of the last scan plus stores since */
+
+		std::atomic<uint64_t> hits{0};
+		std::atomic<uint64_t> misses{0};
+		std::atomic<uint64_t> stores{0};
+		std::atomic<uint64_t> evictions{0};
+		std::atomic<uint64_t> bytesEvicted{0};
+		std::atomic<uint64_t> temporaries{0};	/* Names temporary files apart */
+	};
+
+}}
+
+#endif // __TOKEN_CACHE_H__
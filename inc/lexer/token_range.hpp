@@ -0,0 +1,79 @@
+#ifndef __TOKEN_RANGE_H__
+#define __TOKEN_RANGE_H__
+
+#include "lexer.hpp"
+#include "token.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+
+namespace threeD { namespace Lexer {
+
+	/*
+	 * The remaining tokens of a Lexer as a lazy input range, EOF_ excluded:
+	 *
+	 *     for (const Token& token : TokenRange(lexer))
+	 *     auto names = TokenRange(lexer) | std::views::filter(isIdentifier);
+	 *
+	 * nextToken() writes each token straight into the range, and the iterator
+	 * hands out a reference to it. Everything but nextToken() itself inlines
+	 * into the consumer, so a range-for compiles to the hand-written loop.
+	 *
+	 * Single pass: begin() lexes the first token, call it once. A reference
+	 * is valid until the iterator is incremented.
+	 */
+	class TokenRange
+	{
+	public:
+		struct sentinel {};
+
+		class iterator
+		{
+		public:
+			using value_type = Token;
+			using reference = const Token&;
+			using difference_type = std::ptrdiff_t;
+			using iterator_category = std::input_iterator_tag;
+
+			iterator() = default;
+
+			const Token& operator*() const { return range->current; }
+			const Token* operator->() const { return &range->current; }
+
+			iterator& operator++()
+			{
+				range->current = range->from->nextToken();
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+
+			friend bool operator==(const iterator& it, sentinel) { return it.atEnd(); }
+
+		private:
+			friend class TokenRange;
+			explicit iterator(TokenRange* range) : range(range) {}
+			bool atEnd() const { return range->current.type == TokenType::EOF_; }
+
+			TokenRange* range = nullptr;
+		};
+
+		explicit TokenRange(Lexer& lexer) : from(&lexer) {}
+
+		iterator begin()
+		{
+			current = from->nextToken();
+			return iterator(this);
+		}
+		sentinel end() const { return {}; }
+
+	private:
+		Lexer* from;
+		Token current{};
+	};
+
+	static_assert(std::ranges::input_range<TokenRange>, "TokenRange should compose with std::views");
+
+}}
+
+#endif // __TOKEN_RANGE_H__
@@ -0,0 +1,81 @@
+#ifndef __TOKEN_STREAM_H__
+#define __TOKEN_STREAM_H__
+
+#include "literal.hpp"
+#include "symbol.hpp"
+#include "token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	// Every token of one file stored as parallel arrays (struct of arrays),
+	// so scans over a single field touch only that field's memory.
+	// The EOF_ token is not stored, lines come from SourceManager::lines().
+	struct TokenStream {
+	public:
+		FileId file = InvalidFileId;
+		std::vector<TokenType> types;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> lengths;
+		std::vector<uint32_t> values;
+		LiteralTable literals;		/* What values of literals refer to */
+		SymbolTable symbols;		/* What values of identifiers refer to, empty if interned elsewhere */
+
+		size_t size() const { return types.size(); }
+		bool empty() const { return types.empty(); }
+
+		Token operator[](size_t i) const { return {types[i], file, offsets[i], lengths[i], values[i]}; }
+		std::string_view lexeme(size_t i, std::string_view source) const { return source.substr(offsets[i], lengths[i]); }
+
+		void reserve(size_t tokens)
+		{
+			types.reserve(tokens);
+			offsets.reserve(tokens);
+			lengths.reserve(tokens);
+			values.reserve(tokens);
+		}
+
+		void push(const Token& token)
+		{
+			types.push_back(token.type);
+			offsets.push_back(token.offset);
+			lengths.push_back(token.length);
+			values.push_back(token.value);
+		}
+
+		// Scripts average 6 or more bytes per token, denser input grows the arrays once
+		static size_t estimateTokens(size_t sourceSize) { return sourceSize / 6 + 16; }
+	};
+
+	// Read-only TokenStream over arrays owned elsewhere, eg. a mapped TokenCache
+	// entry. Valid as long as the arrays are.
+	struct TokenStreamView {
+	public:
+		FileId file = InvalidFileId;
+		const TokenType* types = nullptr;
+		const uint32_t* offsets = nullptr;
+		const uint32_t* lengths = nullptr;
+		const uint32_t* values = nullptr;
+		const LiteralTable* literals = nullptr;
+		const SymbolTable* symbols = nullptr;
+		size_t count = 0;
+
+		TokenStreamView() = default;
+		TokenStreamView(const TokenStream& stream)
+			: file(stream.file), types(stream.types.data()), offsets(stream.offsets.data()), lengths(stream.lengths.data()),
+			values(stream.values.data()), literals(&stream.literals), symbols(&stream.symbols), count(stream.size()) {}
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		Token operator[](size_t i) const { return {types[i], file, offsets[i], lengths[i], values[i]}; }
+		std::string_view lexeme(size_t i, std::string_view source) const { return source.substr(offsets[i], lengths[i]); }
+	};
+
+}}
+
+#endif // __TOKEN_STREAM_H__
@@ -0,0 +1,84 @@
+#ifndef __AST_H__
+#define __AST_H__
+
+#include "lexer/token.hpp"
+#include "lexer/token_stream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Parser {
+
+	using Lexer::TokenType;
+
+	// Index of a node in Ast::nodes
+	using NodeId = uint32_t;
+	constexpr NodeId InvalidNodeId = UINT32_MAX;
+
+	// Index of a list in Ast::lists
+	using ListId = uint32_t;
+
+	// What a node is, and what its token, first and second fields hold
+	enum class NodeKind : uint8_t {
+		Script,			/* first: list of Functions and statements */
+		Function,		/* token: name, first: Prototype, second: list of statements */
+		Prototype,		/* token: def, first: list of Parameters, second: return type token or InvalidNodeId */
+		Parameter,		/* token: name, first: type token */
+		Let,			/* token: name, first: value */
+		Assign,			/* token: name, op: ASSIGN or one of the compound ones, first: value */
+		Return,			/* token: ret, first: value or InvalidNodeId */
+		Call,			/* token: callee, first: list of arguments */
+		Binary,			/* token and op: operator, first: left, second: right */
+		Conditional,	/* token: ?, first: condition, second: list of the two results */
+		Unary,			/* token and op: operator, first: operand */
+		Name,			/* token: the identifier, its value is the SymbolId */
+		Literal,		/* token and op: the literal, its value is the decoded one, see LiteralTable */
+	};
+
+	std::ostream& operator<<(std::ostream& out, const NodeKind& kind);
+
+	// Tokens are referred to by their index in the stream the Ast was parsed from,
+	// op is EOF_ where NodeKind does not say what it holds
+	struct Node {
+	public:
+		NodeKind kind;
+		TokenType op;
+		uint32_t token;
+		uint32_t first;
+		uint32_t second;
+	};
+
+	static_assert(sizeof(Node) == 16, "Node should stay compact");
+
+	/*
+	 * Syntax tree of one file, flat: every node lives in one vector and refers
+	 * to its children by index, never by pointer. Nodes are only ever appended,
+	 * children before their parent, so building the tree is a bump allocation
+	 * into nodes and walking it touches one contiguous array. Children that
+	 * come in variable numbers are a list, a count followed by that many node
+	 * ids in lists. Nodes of statements that failed to parse stay in nodes,
+	 * unreachable from root.
+	 */
+	struct Ast {
+	public:
+		std::vector<Node> nodes;
+		std::vector<NodeId> lists;
+		NodeId root = InvalidNodeId;
+
+		const Node& operator[](NodeId id) const { return nodes[id]; }
+		std::span<const NodeId> list(ListId id) const { return {lists.data() + id + 1, lists[id]}; }
+		size_t size() const { return nodes.size(); }
+		bool empty() const { return nodes.empty(); }
+	};
+
+	// Prints ast back as source, one statement per line and every operator
+	// parenthesized, so the result parses to the same tree and shows its shape
+	void print(std::ostream& out, const Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source);
+
+}}
+
+#endif // __AST_H__
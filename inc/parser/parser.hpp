@@ -0,0 +1,81 @@
+#ifndef __PARSER_H__
+#define __PARSER_H__
+
+#include "ast.hpp"
+
+#include "lexer/diagnostic.hpp"
+#include "lexer/token_stream.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Parser {
+
+	/*
+	 * Recursive descent parser from a lexed TokenStream to an Ast:
+	 *
+	 *     script     := (function | statement)*
+	 *     function   := 'def' name '(' (parameter (',' parameter)*)? ')' ('->' type)? ':' statement*
+	 *     parameter  := name ':' type
+	 *     statement  := 'let' name ':=' expression | 'ret' expression?
+	 *                 | name (':=' | '+=' | '-=' | '*=' | '/=') expression | call
+	 *     expression := binary ('?' expression ':' expression)?
+	 *     binary     := binary operators over ('!' | '-')* (literal | name | call | '(' expression ')')
+	 *
+	 * A function's body runs to the next def. There are no statement
+	 * separators, every statement starts with a token no expression continues
+	 * with. Binary operators bind from || (loosest) to * / % (tightest).
+	 *
+	 * Errors go to diagnostics, one per statement: the parser skips to the next
+	 * let, ret or def and carries on. ERROR tokens were reported by the lexer
+	 * and end the statement without another diagnostic.
+	 */
+	class Parser
+	{
+	public:
+		// source is the text tokens were lexed from, for error messages
+		Parser(const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics);
+
+		Ast parse();
+
+		// Parentheses, conditionals and unary operators nested deeper than this are an error
+		static constexpr unsigned maxDepth = 256;
+
+	private:
+		TokenType peek(size_t k = 0) const { return at + k < tokens.size() ? tokens.types[at + k] : TokenType::EOF_; }
+		bool accept(TokenType type);
+		bool expect(TokenType type, const char* what);
+		void error(std::string message);
+		void expected(const char* what);
+		void synchronize();
+
+		NodeId add(NodeKind kind, TokenType op, uint32_t token, uint32_t first = InvalidNodeId, uint32_t second = InvalidNodeId);
+		ListId endList(size_t scratchStart);
+
+		NodeId function();
+		NodeId prototype();
+		NodeId statement();
+		NodeId expression();
+		NodeId binary(int minimum = 1);
+		NodeId unary();
+		NodeId primary();
+		NodeId call();
+
+		Lexer::TokenStreamView tokens;
+		std::string_view source;
+		Lexer::DiagnosticEngine& diagnostics;
+		Ast ast;
+		std::vector<NodeId> scratch;		/* Items of the lists being parsed, innermost last */
+		uint32_t at = 0;					/* Index of the next token */
+		unsigned depth = 0;
+	};
+
+	// Parser(tokens, source, diagnostics).parse()
+	Ast parse(const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics);
+
+}}
+
+#endif // __PARSER_H__
@@ -0,0 +1,102 @@
+#ifndef __BYTECODE_H__
+#define __BYTECODE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace threeD { namespace Vm {
+
+	/*
+	 * Every instruction, in the order of Op. R is the frame's registers, K the
+	 * program's constants, a, b and c the operand bytes, bx = b | c << 8 and
+	 * sbx the same as a signed offset. Integer and float forms are separate,
+	 * the compiler knows the type of every register.
+	 *
+	 *	LOADK	R[a] = K[bx]
+	 *	LOADI	R[a] = sbx
+	 *	MOVE	R[a] = R[b]
+	 *	ADD..MOD, FADD..FMOD		R[a] = R[b] op R[c]
+	 *	ADDI	R[a] = R[b] + c, c a signed byte
+	 *	EQ..GEQ, FEQ..FGEQ			R[a] = R[b] op R[c], 1 or 0
+	 *	NOT		R[a] = R[b] == 0
+	 *	NEG, FNEG					R[a] = -R[b]
+	 *	ITOF, FTOI, BOOL, FBOOL		R[a] = R[b] converted, BOOL is R[b] != 0
+	 *	JMP		pc += sbx
+	 *	JMPF, JMPT					pc += sbx if R[a] is 0, is not 0
+	 *	CALL	R[a] = function bx(R[a], R[a + 1], ...), its frame starts at R[a]
+	 *	TAILCALL					the same, reusing the frame of the caller
+	 *	RET		return R[a]
+	 */
+	#define THREED_VM_OPS(X) \
+		X(LOADK) X(LOADI) X(MOVE) \
+		X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(ADDI) \
+		X(FADD) X(FSUB) X(FMUL) X(FDIV) X(FMOD) \
+		X(EQ) X(NEQ) X(LT) X(LEQ) X(GT) X(GEQ) \
+		X(FEQ) X(FNEQ) X(FLT) X(FLEQ) X(FGT) X(FGEQ) \
+		X(NOT) X(NEG) X(FNEG) \
+		X(ITOF) X(FTOI) X(BOOL) X(FBOOL) \
+		X(JMP) X(JMPF) X(JMPT) \
+		X(CALL) X(TAILCALL) X(RET)
+
+	enum class Op : uint8_t {
+	#define THREED_VM_ENUM(name) name,
+		THREED_VM_OPS(THREED_VM_ENUM)
+	#undef THREED_VM_ENUM
+	};
+
+	const char* opName(Op op);
+
+	struct Instruction {
+	public:
+		Op op;
+		uint8_t a;
+		uint8_t b;
+		uint8_t c;
+
+		uint16_t bx() const { return static_cast<uint16_t>(b | c << 8); }
+		int16_t sbx() const { return static_cast<int16_t>(bx()); }
+
+		static Instruction make(Op op, uint8_t a, uint8_t b = 0, uint8_t c = 0) { return {op, a, b, c}; }
+		static Instruction wide(Op op, uint8_t a, uint16_t bx) { return {op, a, static_cast<uint8_t>(bx), static_cast<uint8_t>(bx >> 8)}; }
+	};
+
+	static_assert(sizeof(Instruction) == 4, "Instruction should stay compact");
+
+	// Registers hold no type, bools are the integers 1 and 0
+	union Value {
+		int64_t i;
+		double f;
+	};
+
+	using FunctionId = uint32_t;
+	constexpr FunctionId InvalidFunctionId = UINT32_MAX;
+
+	struct Function {
+	public:
+		std::string name;
+		uint32_t entry = 0;			/* Index of the first instruction in Program::code */
+		uint8_t parameters = 0;		/* Arguments arrive in the first registers */
+		uint16_t registers = 0;		/* Registers the frame needs, parameters included */
+	};
+
+	// Compiled functions and what they share. Parameters and results are integers.
+	struct Program {
+	public:
+		std::vector<Instruction> code;
+		std::vector<Value> constants;
+		std::vector<Function> functions;
+
+		// InvalidFunctionId if there is no function called name
+		FunctionId find(std::string_view name) const;
+	};
+
+	// One line per instruction, functions headed by their name
+	void disassemble(std::ostream& out, const Program& program);
+
+}}
+
+#endif // __BYTECODE_H__
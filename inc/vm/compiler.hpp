@@ -0,0 +1,104 @@
+#ifndef __COMPILER_H__
+#define __COMPILER_H__
+
+#include "bytecode.hpp"
+
+#include "lexer/diagnostic.hpp"
+#include "lexer/token_stream.hpp"
+#include "parser/ast.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace threeD { namespace Vm {
+
+	using Lexer::TokenType;
+	using Parser::NodeId;
+
+	/*
+	 * Compiles the functions of an Ast to register bytecode for Machine.
+	 *
+	 * Every expression has a type known while compiling: parameters, results
+	 * and calls are int, literals what they spell, and let variables keep the
+	 * type of their first value. Arithmetic on an int and a float is float,
+	 * comparisons and && || ! are bool, and bool counts as 0 or 1 wherever a
+	 * number is wanted. Assigning to a variable, passing an argument or
+	 * returning converts to the type wanted there, floats truncate.
+	 *
+	 * Parameters take the first registers of a frame and each let the next
+	 * one for the rest of the function. Temporaries live above them for the
+	 * length of a statement. A call puts its arguments in the first free
+	 * registers, which become the callee's frame, so nothing is copied.
+	 * ret f(...) reuses the caller's frame, recursion in tail position runs
+	 * in constant space.
+	 *
+	 * Errors go to diagnostics, one per statement. The program only runs
+	 * correctly if there were none.
+	 */
+	class Compiler
+	{
+	public:
+		Compiler(const Parser::Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics);
+
+		Program compile();
+
+	private:
+		enum class Type : uint8_t { Int, Float, Bool };
+
+		struct Local
+		{
+			uint32_t symbol;
+			uint8_t reg;
+			Type type;
+		};
+
+		void function(NodeId id, FunctionId function);
+		void statement(NodeId id);
+		void returnValue(NodeId id);
+
+		Type expression(NodeId id, uint8_t target);
+		uint8_t operand(NodeId id, Type& type);
+		Type typeOf(NodeId id) const;
+		Type arithmetic(TokenType op, uint32_t token, uint8_t target, uint8_t left, Type leftType, uint8_t right, Type rightType);
+		Type logical(const Parser::Node& node, uint8_t target);
+		Type conditional(NodeId id, uint8_t target);
+		uint8_t condition(NodeId id);
+		void call(const Parser::Node& node, uint8_t base, bool tail);
+		void convert(uint8_t reg, Type from, Type to);
+
+		uint8_t allocate(uint32_t token);
+		const Local* find(uint32_t token) const;
+		const Local* local(uint32_t token);
+		FunctionId callee(uint32_t token);
+		uint16_t constant(Value value, bool isFloat);
+
+		size_t emit(Instruction instruction) { program.code.push_back(instruction); return program.code.size() - 1; }
+		void patch(size_t jump, uint32_t token);
+		void error(uint32_t token, std::string message);
+
+		const Parser::Ast& ast;
+		Lexer::TokenStreamView tokens;
+		std::string_view source;
+		Lexer::DiagnosticEngine& diagnostics;
+		Program program;
+		std::unordered_map<uint32_t, FunctionId> functions;		/* By SymbolId of the name */
+		std::unordered_map<uint64_t, uint16_t> integers;		/* Constant index by value */
+		std::unordered_map<uint64_t, uint16_t> floats;			/* By bit pattern */
+
+		// Of the function being compiled
+		std::vector<Local> locals;
+		unsigned top = 0;			/* First free register */
+		unsigned registers = 0;		/* Most registers in use at once */
+		bool failed = false;		/* The current statement had an error */
+	};
+
+	// Compiler(ast, tokens, source, diagnostics).compile()
+	Program compile(const Parser::Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics);
+
+}}
+
+#endif // __COMPILER_H__
@@ -0,0 +1,59 @@
+#ifndef __MACHINE_H__
+#define __MACHINE_H__
+
+#include "bytecode.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace threeD { namespace Vm {
+
+	/*
+	 * Interpreter for a compiled Program. Registers of every frame live in one
+	 * stack allocated up front, a call only moves the base of the frame.
+	 *
+	 * Integer arithmetic wraps, division or modulo by zero stops the program
+	 * with an error, and a float converted to int saturates (NaN is 0).
+	 *
+	 * Instructions are dispatched with computed goto where the compiler has
+	 * it, every handler jumping straight to the next one, or with a switch if
+	 * THREED_VM_SWITCH_DISPATCH is defined.
+	 */
+	class Machine
+	{
+	public:
+		// stackRegisters bounds the registers of all frames together
+		explicit Machine(const Program& program, size_t stackRegisters = size_t(1) << 20);
+
+		// Runs function with arguments into result, false with error() set if it stopped
+		bool call(FunctionId function, std::span<const int64_t> arguments, int64_t& result);
+
+		const std::string& error() const { return message; }
+
+		// "computed goto" or "switch", how this build dispatches instructions
+		static const char* dispatch();
+
+		// Calls nested deeper than this are a stack overflow
+		static constexpr size_t maxFrames = size_t(1) << 16;
+
+	private:
+		struct Frame
+		{
+			const Instruction* returnPc;
+			Value* base;
+		};
+
+		bool fail(std::string error);
+
+		const Program& program;
+		std::vector<Value> stack;
+		std::vector<Frame> frames;
+		std::string message;
+	};
+
+}}
+
+#endif // __MACHINE_H__
@@ -0,0 +1,208 @@
+#include "lexer/batch.hpp"
+#include "lexer/lexer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <system_error>
+
+namespace threeD { namespace Lexer {
+
+	// Indices of sizes, largest first. Ties keep their order so scheduling is repeatable.
+	static std::vector<size_t> largestFirst(const std::vector<uintmax_t>& sizes)
+	{
+		std::vector<size_t> order(sizes.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+		return order;
+	}
+
+	static void lexInto(SourceManager& sources, FileId file, Recovery recovery, ConcurrentSymbolTable* symbols, LexedFile& result)
+	{
+		// Every worker gets its own Lexer, the tables they share are constexpr or locked
+		Lexer lexer(sources, file);
+		lexer.reportTo(result.diagnostics);
+		lexer.setRecovery(recovery);
+		if (symbols)
+			lexer.internInto(*symbols);
+		result.file = file;
+		result.tokens = lexer.tokenizeAll();
+	}
+
+	std::vector<LexedFile> lexFiles(SourceManager& sources, const std::vector<FileId>& files, ThreadPool& pool, Recovery recovery, ConcurrentSymbolTable* symbols)
+	{
+		std::vector<uintmax_t> sizes;
+		for (auto file : files)
+			sizes.push_back(sources.contents(file).size());
+
+		std::vector<LexedFile> results(files.size());
+		pool.run(largestFirst(sizes), [&](size_t i) {
+			lexInto(sources, files[i], recovery, symbols, results[i]);
+		});
+		return results;
+	}
+
+	std::vector<LexedFile> lexFiles(SourceManager& sources, const std::vector<std::string>& paths, ThreadPool& pool, Recovery recovery, ConcurrentSymbolTable* symbols)
+	{
+		std::vector<uintmax_t> sizes;
+		for (auto& path : paths)
+		{
+			std::error_code error;
+			auto size = std::filesystem::file_size(path, error);
+			sizes.push_back(error ? 0 : size);
+		}
+
+		std::vector<LexedFile> results(paths.size());
+		pool.run(largestFirst(sizes), [&](size_t i) {
+			auto file = sources.addFile(paths[i], &results[i].diagnostics);
+			if (file == InvalidFileId)
+				return;
+			lexInto(sources, file, recovery, symbols, results[i]);
+		});
+		return results;
+	}
+
+	/*
+	 * Tokens never span lines and only block comments do, so at the start of
+	 * every line the sequential lexer is either in START or in BLOCK_COMMENT
+	 * (or has stopped at an error). Chunks end right after a newline, which
+	 * makes their entry state the only thing they need from the chunk before.
+	 */
+	struct Chunk
+	{
+		uint32_t begin;
+		uint32_t end;
+		Lexer::LexerState entry;
+		Lexer::LexerState exit;
+		TokenStream tokens;
+		DiagnosticEngine diagnostics;
+	};
+
+	static void lexChunk(SourceManager& sources, FileId file, Recovery recovery, Chunk& chunk, Lexer::LexerState entry)
+	{
+		chunk.diagnostics.clear();
+		Lexer lexer(sources, file, chunk.begin, chunk.end, entry);
+		lexer.reportTo(chunk.diagnostics);
+		lexer.setRecovery(recovery);
+		chunk.entry = entry;
+		chunk.tokens = lexer.tokenizeAll();
+		chunk.exit = lexer.currentState();
+	}
+
+	// Guesses whether begin lies inside a block comment from the closest "/*" or
+	// "*/" before it. Strings and line comments can fool it, a wrong guess only
+	// costs lexing the chunk again.
+	static Lexer::LexerState guessEntry(std::string_view source, size_t begin)
+	{
+		constexpr size_t window = 1 << 16;
+		for (size_t p = begin; p > 1 && begin - p < window; p--)
+		{
+			if (source[p - 1] == '/' && source[p - 2] == '*')
+				return Lexer::LexerState::START;
+			if (source[p - 1] == '*' && source[p - 2] == '/')
+				return Lexer::LexerState::BLOCK_COMMENT;
+		}
+		return Lexer::LexerState::START;
+	}
+
+	LexedFile lexChunked(SourceManager& sources, FileId file, ThreadPool& pool, Recovery recovery, size_t chunkSize)
+	{
+		auto source = sources.contents(file);
+
+		// A few chunks per worker so stealing can even out dense and sparse regions
+		if (chunkSize == 0)
+			chunkSize = std::max<size_t>(source.size() / (pool.size() * 4), 1 << 20);
+
+		std::vector<Chunk> chunks;
+		for (size_t begin = 0; begin < source.size() || chunks.empty();)
+		{
+			auto newline = source.find('\n', std::min(begin + chunkSize, source.size()) - 1);
+			auto end = newline == std::string_view::npos ? source.size() : newline + 1;
+			// SourceManager holds no file over maxFileSize, the bounds fit in 32 bits
+			chunks.push_back({static_cast<uint32_t>(begin), static_cast<uint32_t>(end), Lexer::LexerState::START, Lexer::LexerState::START, {}, {}});
+			begin = end;
+		}
+
+		// Speculate on the entry state
+		std::vector<size_t> items(chunks.size());
+		std::iota(items.begin(), items.end(), 0);
+		pool.run(items, [&](size_t i) {
+			lexChunk(sources, file, recovery, chunks[i], guessEntry(source, chunks[i].begin));
+		});
+
+		// Walk the chunks in order and lex again every chunk entered in the wrong
+		// state. With Recovery::Stop nothing after the first chunk that fails is used.
+		auto entry = Lexer::LexerState::START;
+		size_t used = chunks.size();
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			auto& chunk = chunks[i];
+			if (chunk.entry != entry)
+				lexChunk(sources, file, recovery, chunk, entry);
+
+			entry = chunk.exit;
+			if (recovery == Recovery::Stop && !chunk.diagnostics.empty())
+			{
+				used = i + 1;
+				break;
+			}
+		}
+
+		std::vector<size_t> tokenBase(used + 1, 0);
+		for (size_t i = 0; i < used; i++)
+			tokenBase[i + 1] = tokenBase[i] + chunks[i].tokens.size();
+
+		LexedFile result;
+		result.file = file;
+		auto& tokens = result.tokens;
+		tokens.file = file;
+		tokens.types.resize(tokenBase[used]);
+		tokens.offsets.resize(tokenBase[used]);
+		tokens.lengths.resize(tokenBase[used]);
+		tokens.values.resize(tokenBase[used]);
+
+		// Literals and symbols are numbered per chunk, the merged tables renumber them.
+		// Symbols merged in chunk order get the ids one Lexer would have given them.
+		std::vector<LiteralTable::Bases> literalBase(used);
+		std::vector<std::vector<SymbolId>> symbolIds(used);
+		for (size_t i = 0; i < used; i++)
+		{
+			literalBase[i] = tokens.literals.append(chunks[i].tokens.literals);
+			symbolIds[i] = tokens.symbols.append(chunks[i].tokens.symbols);
+		}
+
+		items.resize(used);
+		pool.run(items, [&](size_t i) {
+			auto& part = chunks[i].tokens;
+			std::copy(part.types.begin(), part.types.end(), tokens.types.begin() + tokenBase[i]);
+			std::copy(part.offsets.begin(), part.offsets.end(), tokens.offsets.begin() + tokenBase[i]);
+			std::copy(part.lengths.begin(), part.lengths.end(), tokens.lengths.begin() + tokenBase[i]);
+			for (size_t j = 0; j < part.size(); j++)
+			{
+				auto value = part.values[j];
+				tokens.values[tokenBase[i] + j] = part.types[j] == TokenType::IDENTIFIER
+					? symbolIds[i][value] : LiteralTable::rebase(part.types[j], value, literalBase[i]);
+			}
+			part = {};
+		});
+
+		for (size_t i = 0; i < used; i++)
+			result.diagnostics.merge(std::move(chunks[i].diagnostics));
+		return result;
+	}
+
+	std::vector<std::string> findScripts(const std::string& directory)
+	{
+		std::vector<std::string> scripts;
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+		{
+			std::error_code statError;
+			if (it->is_regular_file(statError) && it->path().extension() == ".tds")
+				scripts.push_back(it->path().string());
+		}
+		std::sort(scripts.begin(), scripts.end());
+		return scripts;
+	}
+
+}}
@@ -0,0 +1,68 @@
+#ifndef __CHARS_H__
+#define __CHARS_H__
+
+#include <array>
+#include <cstdint>
+
+namespace threeD { namespace Lexer { namespace Chars {
+
+	// Character classes, a byte may belong to several
+	enum Class : uint16_t
+	{
+		Alpha			= 1 << 0,	/* A-Z a-z */
+		Digit			= 1 << 1,	/* 0-9 */
+		Punct			= 1 << 2,	/* Printable, not alphanumeric, not space */
+		Space			= 1 << 3,	/* ' ' \t \n \v \f \r */
+		IdentStart		= 1 << 4,	/* Alpha or _ */
+		IdentContinue	= 1 << 5,	/* Alpha, Digit or _ */
+		Escape			= 1 << 6,	/* Valid after a backslash in char and string literals */
+		Printable		= 1 << 7,	/* ' ' to '~', what char and string literals may contain */
+		HexDigit		= 1 << 8,	/* 0-9 A-F a-f */
+	};
+
+	constexpr std::array<uint16_t, 256> build()
+	{
+		std::array<uint16_t, 256> table = {};
+		for (int c = 0; c < 256; c++)
+		{
+			uint16_t classes = 0;
+			bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+			bool digit = c >= '0' && c <= '9';
+			bool printable = c >= 0x20 && c <= 0x7E;
+
+			if (alpha)
+				classes |= Alpha | IdentStart | IdentContinue;
+			if (digit)
+				classes |= Digit | IdentContinue;
+			if (digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+				classes |= HexDigit;
+			if (c == '_')
+				classes |= IdentStart | IdentContinue;
+			if (printable)
+				classes |= Printable;
+			if (printable && !alpha && !digit && c != ' ')
+				classes |= Punct;
+			if (c == ' ' || (c >= '\t' && c <= '\r'))
+				classes |= Space;
+			table[c] = classes;
+		}
+
+		for (char c : {'\'', '\"', '?', '\\', 'a', 'b', 'f', 'n', 'r', 't', 'v', '0'})
+			table[static_cast<uint8_t>(c)] |= Escape;
+
+		return table;
+	}
+
+	// Matches the <cctype> functions in the "C" locale, for every byte and whatever the locale
+	constexpr std::array<uint16_t, 256> table = build();
+
+	// True if c belongs to any of classes. c is a byte value or EOF,
+	// EOF wraps to 0xFF which belongs to no class.
+	constexpr bool is(int c, uint16_t classes)
+	{
+		return (table[static_cast<uint8_t>(c)] & classes) != 0;
+	}
+
+}}}
+
+#endif // __CHARS_H__
@@ -0,0 +1,60 @@
+#include "lexer/diagnostic.hpp"
+#include "lexer/source_manager.hpp"
+#include "chars.hpp"
+
+#include <iterator>
+
+namespace threeD { namespace Lexer {
+
+	static void findAndReplaceAll(std::string & data, std::string toSearch, std::string replaceStr)
+	{
+		// Get the first occurrence
+		size_t pos = data.find(toSearch);
+		// Repeat till end is reached
+		while( pos != std::string::npos)
+		{
+			// Replace this occurrence of Sub String
+			data.replace(pos, toSearch.size(), replaceStr);
+			// Get the next occurrence from the current position
+			pos =data.find(toSearch, pos + replaceStr.size());
+		}
+	}
+
+	void DiagnosticEngine::merge(DiagnosticEngine&& other)
+	{
+		diagnostics.insert(diagnostics.end(), std::make_move_iterator(other.diagnostics.begin()), std::make_move_iterator(other.diagnostics.end()));
+		other.diagnostics.clear();
+	}
+
+	std::string DiagnosticEngine::render(const Diagnostic& diagnostic, const SourceManager& sources)
+	{
+		if (diagnostic.file == InvalidFileId)
+			return "error: " + diagnostic.message + "\n";
+
+		// Positions are only worked out here, from the file's line index
+		auto& lines = sources.lines(diagnostic.file);
+		auto at = lines.location(diagnostic.offset);
+		auto curLine = std::string(lines.lineText(at.line));
+
+		// Whitespace is kept so the caret lines up with tabs, everything else becomes a space
+		std::string curLineWhitespace;
+		for (size_t i = 0; i < curLine.size() && static_cast<int>(i) < at.column; i++)
+			curLineWhitespace += Chars::is(static_cast<uint8_t>(curLine[i]), Chars::Space) ? curLine[i] : ' ';
+
+		findAndReplaceAll(curLine, "\t", "    ");
+		findAndReplaceAll(curLineWhitespace, "\t", "    ");
+
+		auto line = std::to_string(at.line);
+		auto whitespaces = std::string(line.length() + 1, ' ');
+		return std::string(sources.name(diagnostic.file)) + ":" + line + ":" + std::to_string(at.column) + ": error: " + diagnostic.message + "\n"
+			+ " " + line + "|" + curLine + "\n"
+			+ curLineWhitespace + whitespaces + "^\n";
+	}
+
+	void DiagnosticEngine::print(std::ostream& out, const SourceManager& sources) const
+	{
+		for (auto& diagnostic : diagnostics)
+			out << render(diagnostic, sources);
+	}
+
+}}
@@ -0,0 +1,76 @@
+#include "lexer/incremental.hpp"
+#include "lexer/lexer.hpp"
+
+#include <algorithm>
+
+namespace threeD { namespace Lexer {
+
+	TokenEdit relex(SourceManager& sources, FileId file, TokenStream& stream, const Edit& edit, DiagnosticEngine* diagnostics, Recovery recovery, SymbolTable* symbols)
+	{
+		auto source = sources.contents(file);
+		int64_t delta = static_cast<int64_t>(edit.inserted) - static_cast<int64_t>(edit.removed);
+		uint32_t editEnd = edit.offset + edit.inserted;		/* In the new text */
+
+		// Restart at the last token that starts before the edit, it may grow into it
+		auto& offsets = stream.offsets;
+		size_t first = std::lower_bound(offsets.begin(), offsets.end(), edit.offset) - offsets.begin();
+		uint32_t restart = 0;
+		if (first > 0)
+			restart = offsets[--first];
+
+		Lexer lexer(sources, file, restart, static_cast<uint32_t>(source.size()), Lexer::LexerState::START);
+		lexer.setRecovery(recovery);
+		lexer.internInto(symbols ? *symbols : stream.symbols);
+
+		// Lex until a token lines up with an old one past the edit
+		TokenStream fresh;
+		size_t old = first;
+		bool resynced = false;
+		for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken())
+		{
+			if (token.offset >= editEnd)
+			{
+				while (old < offsets.size() && offsets[old] + delta < token.offset)
+					old++;
+				if (old < offsets.size() && offsets[old] + delta == token.offset)
+				{
+					resynced = true;
+					break;
+				}
+			}
+			fresh.push(token);
+		}
+		if (!resynced)
+			old = offsets.size();
+
+		// Tokens after the resync point keep their type and length, only their offset moves
+		for (size_t i = old; i < offsets.size(); i++)
+			offsets[i] = static_cast<uint32_t>(offsets[i] + delta);
+
+		// New values go after the old ones, those of the replaced tokens stay unused
+		auto bases = stream.literals.append(lexer.literals());
+		for (size_t i = 0; i < fresh.size(); i++)
+			fresh.values[i] = LiteralTable::rebase(fresh.types[i], fresh.values[i], bases);
+
+		TokenEdit result = {first, old - first, fresh.size()};
+		auto splice = [&](auto& field, auto& replacement) {
+			field.erase(field.begin() + first, field.begin() + old);
+			field.insert(field.begin() + first, replacement.begin(), replacement.end());
+		};
+		splice(stream.types, fresh.types);
+		splice(stream.offsets, fresh.offsets);
+		splice(stream.lengths, fresh.lengths);
+		splice(stream.values, fresh.values);
+		stream.file = file;
+
+		// One diagnostic per ERROR token, the token lexing stopped at is not part of the edit
+		if (diagnostics)
+		{
+			auto& found = lexer.diagnostics();
+			found.truncate(static_cast<size_t>(std::count(fresh.types.begin(), fresh.types.end(), TokenType::ERROR)));
+			diagnostics->merge(std::move(found));
+		}
+		return result;
+	}
+
+}}
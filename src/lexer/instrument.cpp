@@ -0,0 +1,163 @@
+#include "lexer/instrument.hpp"
+#include "lexer/lexer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#endif
+
+namespace threeD { namespace Lexer {
+
+	using State = Lexer::LexerState;
+
+	static_assert(LexerStats::stateCount == static_cast<size_t>(State::BLOCK_COMMENT) + 1, "stateCount does not match LexerState");
+
+	// Follows the order of LexerState
+	static const char* const stateNames[LexerStats::stateCount] = {
+		"START", "ALPHA_UNDERSCORE", "IDENTIFIER", "ZERO", "ZERO_PREFIX", "INT_LITERAL",
+		"SINGLE_QUOTE", "CHAR_ESCAPE", "CHAR_LITERAL", "DOUBLE_QUOTE", "STR_ESCAPE", "STR_LITERAL",
+		"DIGITS", "FLOAT_LITERAL", "PUNCT", "LINE_COMMENT", "BLOCK_COMMENT",
+	};
+
+	static std::mutex globalMutex;
+	static LexerStats globalStats;
+
+	void LexerStats::merge(const LexerStats& other)
+	{
+		for (size_t i = 0; i < stateCount; i++)
+		{
+			stateBytes[i] += other.stateBytes[i];
+			stateVisits[i] += other.stateVisits[i];
+			for (size_t j = 0; j < stateCount; j++)
+				transitions[i][j] += other.transitions[i][j];
+		}
+		for (size_t i = 0; i < typeCount; i++)
+		{
+			tokens[i] += other.tokens[i];
+			tokenBytes[i] += other.tokenBytes[i];
+		}
+		readSamples += other.readSamples;
+		readCycles += other.readCycles;
+		tokenSamples += other.tokenSamples;
+		tokenCycles += other.tokenCycles;
+	}
+
+	uint64_t LexerStats::commentBytes() const
+	{
+		auto punct = static_cast<size_t>(State::PUNCT);
+		auto line = static_cast<size_t>(State::LINE_COMMENT);
+		auto block = static_cast<size_t>(State::BLOCK_COMMENT);
+		// The opening two characters are read in START and PUNCT
+		uint64_t openings = transitions[punct][line] + transitions[punct][block];
+		return stateBytes[line] + stateBytes[block] + 2 * openings;
+	}
+
+	static double percent(uint64_t part, uint64_t whole)
+	{
+		return whole ? 100.0 * part / whole : 0;
+	}
+
+	void LexerStats::print(std::ostream& out) const
+	{
+		if (!enabled)
+		{
+			out << "Lexer statistics need a build configured with THREED_INSTRUMENT" << std::endl;
+			return;
+		}
+
+		uint64_t totalBytes = 0, totalTokens = 0;
+		for (auto bytes : stateBytes)
+			totalBytes += bytes;
+		for (auto count : tokens)
+			totalTokens += count;
+
+		auto flags = out.flags();
+		auto precision = out.precision();
+		out << std::fixed << std::setprecision(1);
+
+		out << std::left << std::setw(18) << "state" << std::right << std::setw(14) << "visits"
+			<< std::setw(14) << "bytes" << std::setw(8) << "%" << "  most frequent next states\n";
+		for (size_t from = 0; from < stateCount; from++)
+		{
+			if (!stateVisits[from] && !stateBytes[from])
+				continue;
+
+			std::vector<std::pair<uint64_t, size_t>> next;
+			for (size_t to = 0; to < stateCount; to++)
+				if (transitions[from][to])
+					next.push_back({transitions[from][to], to});
+			std::sort(next.rbegin(), next.rend());
+
+			out << std::left << std::setw(18) << stateNames[from] << std::right << std::setw(14) << stateVisits[from]
+				<< std::setw(14) << stateBytes[from] << std::setw(8) << percent(stateBytes[from], totalBytes) << " ";
+			for (size_t i = 0; i < next.size() && i < 3; i++)
+				out << " " << stateNames[next[i].second] << " " << next[i].first;
+			out << "\n";
+		}
+
+		out << "\n" << std::left << std::setw(18) << "token" << std::right << std::setw(14) << "count"
+			<< std::setw(14) << "bytes" << std::setw(8) << "%" << std::setw(10) << "length" << "\n";
+		for (size_t type = 0; type < typeCount; type++)
+		{
+			if (!tokens[type])
+				continue;
+			out << std::left << std::setw(18) << static_cast<TokenType>(type) << std::right << std::setw(14) << tokens[type]
+				<< std::setw(14) << tokenBytes[type] << std::setw(8) << percent(tokens[type], totalTokens)
+				<< std::setw(10) << static_cast<double>(tokenBytes[type]) / tokens[type] << "\n";
+		}
+
+		out << "\n" << totalBytes << " bytes, " << totalTokens << " tokens, "
+			<< commentBytes() << " bytes of comments (" << percent(commentBytes(), totalBytes) << "%), "
+			<< stringBytes() << " bytes of literals (" << percent(stringBytes(), totalBytes) << "%)\n";
+		if (readSamples)
+			out << "getNextChar " << static_cast<double>(readCycles) / readSamples << " cycles over " << readSamples << " samples\n";
+		if (tokenSamples)
+			out << "nextToken " << static_cast<double>(tokenCycles) / tokenSamples << " cycles per token over " << tokenSamples << " samples\n";
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+
+	void LexerStats::addToGlobal(const LexerStats& stats)
+	{
+		std::lock_guard<std::mutex> lock(globalMutex);
+		globalStats.merge(stats);
+	}
+
+	LexerStats LexerStats::global()
+	{
+		std::lock_guard<std::mutex> lock(globalMutex);
+		return globalStats;
+	}
+
+	uint64_t LexerStats::now()
+	{
+	#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+	#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	#endif
+	}
+
+	uint64_t LexerStats::timerOverhead()
+	{
+		static const uint64_t overhead = [] {
+			uint64_t least = UINT64_MAX;
+			for (int i = 0; i < 64; i++)
+			{
+				auto start = now();
+				least = std::min(least, now() - start);
+			}
+			return least;
+		}();
+		return overhead;
+	}
+
+}}
@@ -0,0 +1,133 @@
+#ifndef __KEYWORDS_H__
+#define __KEYWORDS_H__
+
+#include "lexer/token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace threeD { namespace Lexer { namespace Keywords {
+
+	struct Keyword
+	{
+		std::string_view spelling;
+		TokenType type;
+	};
+
+	// To add a keyword, add it here. The table below is rebuilt at compile time
+	// and the static_asserts fail if no collision free hash can be found.
+	constexpr Keyword list[] = {
+		{"def", TokenType::DEF},
+		{"dec", TokenType::DEC},
+		{"let", TokenType::LET},
+		{"ret", TokenType::RET},
+		{"int", TokenType::INT},
+		{"true", TokenType::BOOL_LITERAL},
+		{"false", TokenType::BOOL_LITERAL},
+	};
+
+	constexpr size_t count = sizeof(list) / sizeof(list[0]);
+
+	constexpr size_t tableSize()
+	{
+		size_t size = 1;
+		while (size < 2 * count)
+			size *= 2;
+		return size;
+	}
+
+	constexpr size_t minLength()
+	{
+		size_t length = list[0].spelling.size();
+		for (auto& keyword : list)
+			length = keyword.spelling.size() < length ? keyword.spelling.size() : length;
+		return length;
+	}
+
+	constexpr size_t maxLength()
+	{
+		size_t length = 0;
+		for (auto& keyword : list)
+			length = keyword.spelling.size() > length ? keyword.spelling.size() : length;
+		return length;
+	}
+
+	// Only looks at the length and the first and last characters, callers
+	// reject lengths outside [minLength, maxLength] before hashing
+	constexpr uint32_t hash(std::string_view word, uint32_t seed)
+	{
+		uint32_t h = seed ^ static_cast<uint32_t>(word.size());
+		h = (h ^ static_cast<uint8_t>(word[0])) * 0x01000193u;
+		h = (h ^ static_cast<uint8_t>(word[word.size() - 1])) * 0x01000193u;
+		return (h ^ (h >> 15)) & static_cast<uint32_t>(tableSize() - 1);
+	}
+
+	constexpr bool isPerfect(uint32_t seed)
+	{
+		bool used[tableSize()] = {};
+		for (auto& keyword : list)
+		{
+			auto slot = hash(keyword.spelling, seed);
+			if (used[slot])
+				return false;
+			used[slot] = true;
+		}
+		return true;
+	}
+
+	constexpr uint32_t findSeed()
+	{
+		for (uint32_t seed = 0; seed < 4096; seed++)
+		{
+			if (isPerfect(seed))
+				return seed;
+		}
+		return UINT32_MAX;
+	}
+
+	constexpr uint32_t seed = findSeed();
+	static_assert(seed != UINT32_MAX, "No perfect hash for the keyword list, widen the hash or the seed search");
+
+	struct Table
+	{
+		Keyword slots[tableSize()];
+	};
+
+	constexpr Table buildTable()
+	{
+		Table table = {};
+		for (auto& slot : table.slots)
+			slot = {"", TokenType::IDENTIFIER};
+		for (auto& keyword : list)
+			table.slots[hash(keyword.spelling, seed)] = keyword;
+		return table;
+	}
+
+	constexpr Table table = buildTable();
+
+	// Keyword token type for word, or IDENTIFIER. One hash, one compare, no allocation.
+	constexpr TokenType classify(std::string_view word)
+	{
+		if (word.size() < minLength() || word.size() > maxLength())
+			return TokenType::IDENTIFIER;
+
+		auto& slot = table.slots[hash(word, seed)];
+		return slot.spelling == word ? slot.type : TokenType::IDENTIFIER;
+	}
+
+	constexpr bool classifiesEveryKeyword()
+	{
+		for (auto& keyword : list)
+		{
+			if (classify(keyword.spelling) != keyword.type)
+				return false;
+		}
+		return true;
+	}
+
+	static_assert(classifiesEveryKeyword(), "Keyword table is inconsistent");
+
+}}}
+
+#endif // __KEYWORDS_H__
@@ -1,10 +1,43 @@
 #include "lexer/lexer.hpp"
+#include "chars.hpp"
+#include "keywords.hpp"
+#include "operators.hpp"
+#include "scan.hpp"
 
 #include <iostream>
 #include <string>
 #include <cassert>
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+// Computed goto is a GNU extension, other compilers always use the switch
+#if defined(THREED_THREADED_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+	#define THREED_USE_COMPUTED_GOTO 1
+#else
+	#define THREED_USE_COMPUTED_GOTO 0
+#endif
+
+// Counting hooks, see LexerStats. They expand to nothing unless THREED_INSTRUMENT is defined.
+#ifdef THREED_INSTRUMENT
+	#define THREED_VISIT(state_) visit(state_)
+	#define THREED_COUNT_BYTES(bytes) counters.stateBytes[static_cast<size_t>(state)] += (bytes)
+	#define THREED_SAMPLE_BEGIN(clock) \
+		uint64_t sampleStart = ++clock % LexerStats::sampleEvery == 0 ? LexerStats::now() : 0
+	#define THREED_SAMPLE_END(samples, cycles) \
+		if (sampleStart) \
+		{ \
+			auto elapsed = LexerStats::now() - sampleStart; \
+			auto overhead = LexerStats::timerOverhead(); \
+			counters.cycles += elapsed > overhead ? elapsed - overhead : 0; \
+			counters.samples++; \
+		}
+#else
+	#define THREED_VISIT(state_)
+	#define THREED_COUNT_BYTES(bytes)
+	#define THREED_SAMPLE_BEGIN(clock)
+	#define THREED_SAMPLE_END(samples, cycles)
+#endif
 
 /*
  * Rules:
@@ -16,111 +49,120 @@
 
 namespace threeD { namespace Lexer {
 
-	static const std::unordered_map<std::string, TokenType> keywords = {
-		{"def", TokenType::DEF},
-		{"dec", TokenType::DEC},
-		{"let", TokenType::LET},
-		{"ret", TokenType::RET},
-		{"int", TokenType::INT},
-		{"true", TokenType::BOOL_LITERAL},
-		{"false", TokenType::BOOL_LITERAL},
-	};
-
-	static const std::unordered_map<std::string, TokenType> punctOps = {
-		{"+", 	TokenType::ADD},
-		{"-", 	TokenType::SUB},
-		{"*", 	TokenType::MUL},
-		{"/", 	TokenType::DIV},
-		{"%", 	TokenType::MOD},
-		{"==", 	TokenType::EQ},
-		{"!=", 	TokenType::NEQ},
-		{"<", 	TokenType::LT},
-		{"<=", 	TokenType::LEQ},
-		{">", 	TokenType::GT},
-		{">=", 	TokenType::GEQ},
-		{"&&", 	TokenType::AND},
-		{"||", 	TokenType::OR},
-		{"!", 	TokenType::NOT},
-		{":=", 	TokenType::ASSIGN},
-		{"+=", 	TokenType::ADD_ASSIGN},
-		{"-=", 	TokenType::SUB_ASSIGN},
-		{"*=", 	TokenType::MUL_ASSIGN},
-		{"/=", 	TokenType::DIV_ASSIGN},
-		{"->", 	TokenType::ARROW},
-		{"(", 	TokenType::LPAREN},
-		{")", 	TokenType::RPAREN},
-		{"{", 	TokenType::LBRACE},
-		{"}", 	TokenType::RBRACE},
-		{",", 	TokenType::COMMA},
-		{";", 	TokenType::SEMICOLON},
-		{"?", 	TokenType::QUESTION},
-		{":", 	TokenType::COLON}
-	};
-
-	std::unordered_set<char> escapeChars = {
-		'\'', '\"', '?', '\\', 'a', 'b', 'f', 'n', 'r', 't', 'v', '0'
-	};
-
-	std::unordered_set<std::string> findPunctOpsPrefixes()
-	{
-		std::unordered_set<std::string> us;
-		for (auto& pair : punctOps)
-		{
-			for (size_t i = 0; i <= pair.first.length(); i++)
-			{
-				us.insert(pair.first.substr(0, i));
-			}
-		}
-		return us;
+	// A file the manager rejected lexes as empty, see SourceManager::maxFileSize
+	Lexer::Lexer(SourceManager& sources, FileId file)
+		: sources(&sources), fileId(file), source(file == InvalidFileId ? std::string_view() : sources.contents(file)), scan(&Scan::kernels())
+	{
+		cur = source.data();
+		end = cur + source.size();
+		charPos = cur;
+		tokenStart = cur;
+	}
+
+	Lexer::Lexer(SourceManager& sources, FileId file, uint32_t begin, uint32_t end, LexerState state)
+		: Lexer(sources, file)
+	{
+		assert(begin <= end && end <= source.size());
+		cur = source.data() + begin;
+		this->end = source.data() + end;
+		charPos = cur;
+		tokenStart = cur;
+		this->state = state;
 	}
 
-	static const std::unordered_set<std::string> punctOpsPrefixes = findPunctOpsPrefixes();
+	Lexer::Lexer(std::istream& buffer, std::string filename)
+		: Lexer(SourceBuffer::fromStream(buffer), filename)
+	{
+	}
 
-	static void findAndReplaceAll(std::string & data, std::string toSearch, std::string replaceStr)
+	Lexer::Lexer(std::string_view source, std::string filename)
+		: Lexer(SourceBuffer(source), filename)
 	{
-		// Get the first occurrence
-		size_t pos = data.find(toSearch);
-		// Repeat till end is reached
-		while( pos != std::string::npos)
-		{
-			// Replace this occurrence of Sub String
-			data.replace(pos, toSearch.size(), replaceStr);
-			// Get the next occurrence from the current position
-			pos =data.find(toSearch, pos + replaceStr.size());
-		}
 	}
 
-	Lexer::Lexer(std::istream& buffer, std::string filename) : buffer(buffer), filename(filename)
+	Lexer::Lexer(SourceBuffer source, std::string filename)
+		: Lexer(std::make_unique<SourceManager>(), std::move(source), std::move(filename))
 	{
-		std::string curLine;
-		std::getline(buffer, curLine);
-		curLineStream << curLine;
+	}
+
+	// The manager lives on the heap, sources and source stay valid when the lexer moves
+	Lexer::Lexer(std::unique_ptr<SourceManager> owned, SourceBuffer source, std::string filename, DiagnosticEngine rejected)
+		: Lexer(*owned, owned->addBuffer(std::move(filename), std::move(source), &rejected))
+	{
+		ownSources = std::move(owned);
+		ownDiagnostics.merge(std::move(rejected));
 	}
 
 	template<Lexer::LexerState state>
-	bool Lexer::handleState(char nextChar)
+	bool Lexer::handleState(int nextChar)
+	{
+		static_assert(state != state, "handleState not implemented for state");
+		return false;
+	}
+
+	static std::string describe(int nextChar)
 	{
-		static_assert(false, "handleState not implemented for state");
+		static const char hex[] = "0123456789ABCDEF";
+		if (nextChar == EOF)
+			return "Unexpected end of file";
+		if (nextChar == '\n')
+			return "Unexpected end of line";
+		if (Chars::is(nextChar, Chars::Printable))
+			return std::string("Unexpected character: '") + static_cast<char>(nextChar) + "'";
+		return std::string("Unexpected byte 0x") + hex[nextChar >> 4] + hex[nextChar & 15];
+	}
+
+	// Reports the error and turns what was read of the current token into an ERROR
+	// token. Returns true, the token has been emitted.
+	bool Lexer::unexpectedCharacter(int nextChar)
+	{
+		diagnostics().report(fileId, static_cast<uint32_t>(charPos - source.data()), describe(nextChar));
+
+		// The offending byte is kept for the next token if one can start with it.
+		// It is swallowed otherwise, or if it is all there is, so lexing moves on.
+		const char* errorEnd = charPos;
+		bool startsToken = Chars::is(nextChar, Chars::Space | Chars::Punct | Chars::IdentStart | Chars::Digit);
+		if (nextChar != EOF && (!startsToken || errorEnd == tokenStart))
+			errorEnd++;
+
+		switch (recovery)
+		{
+		case Recovery::NextSpace:
+			while (errorEnd != end && !Chars::is(static_cast<uint8_t>(*errorEnd), Chars::Space))
+				errorEnd++;
+			break;
+		case Recovery::NextLine:
+			errorEnd = scan->lineComment(errorEnd, end);
+			break;
+		default:
+			break;
+		}
+
+		state = LexerState::START;
+		emit(TokenType::ERROR, errorEnd);
+		cur = recovery == Recovery::Stop ? end : errorEnd;
+		return true;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::START>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::START>(int nextChar)
 	{
-		lexeme.clear();
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::START);
+		tokenStart = charPos;
 		if(nextChar == '\'')
 		{
 			state = LexerState::SINGLE_QUOTE;
 		}
-		if(nextChar == '\"')
+		else if(nextChar == '\"')
 		{
 			state = LexerState::DOUBLE_QUOTE;
 		}
-		else if (ispunct(nextChar))
+		else if (Chars::is(nextChar, Chars::Punct))
 		{
 			state = LexerState::PUNCT;
+			punctState = Operators::dfa.next[Operators::Dfa::root][static_cast<uint8_t>(nextChar)];
 		}
-		else if(isalpha(nextChar) || nextChar == '_')
+		else if(Chars::is(nextChar, Chars::IdentStart))
 		{
 			state = LexerState::ALPHA_UNDERSCORE;
 		}
@@ -128,637 +170,685 @@ namespace threeD { namespace Lexer {
 		{
 			state = LexerState::ZERO;
 		}
-		else if(isdigit(nextChar))
+		else if(Chars::is(nextChar, Chars::Digit))
 		{
 			state = LexerState::DIGITS;
 		}
-		else if(isspace(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space))
+		{
+			skipTo(scan->blanks(cur, end));
+		}
+		else if(nextChar == EOF)
 		{
-			lexeme.clear();
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::ALPHA_UNDERSCORE>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::ALPHA_UNDERSCORE>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isalnum(nextChar) || nextChar == '_')
+		THREED_VISIT(LexerState::ALPHA_UNDERSCORE);
+		if (Chars::is(nextChar, Chars::IdentContinue))
 		{
 			state = LexerState::IDENTIFIER;
+			skipTo(scan->identifier(cur, end));
 		}
-		else if(isspace(nextChar) || ispunct(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space | Chars::Punct) || nextChar == EOF)
 		{
 			state = LexerState::START;
-			lexeme.pop_back();
 
-			auto keyword = keywords.find(lexeme);
-			if (keyword != keywords.end())
-				nextTokenFound = {keyword->second, lexeme, filename, line, column};
-			else
-				nextTokenFound = {TokenType::IDENTIFIER, lexeme, filename, line, column};
+			emitWord(charPos);
 
 			handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::IDENTIFIER>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::IDENTIFIER>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isalnum(nextChar) || nextChar == '_')
+		THREED_VISIT(LexerState::IDENTIFIER);
+		if (Chars::is(nextChar, Chars::IdentContinue))
 		{
 			state = LexerState::IDENTIFIER;
+			skipTo(scan->identifier(cur, end));
 		}
-		else if(isspace(nextChar) || ispunct(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space | Chars::Punct) || nextChar == EOF)
 		{
 			state = LexerState::START;
-			lexeme.pop_back();
 
-			auto keyword = keywords.find(lexeme);
-			if (keyword != keywords.end())
-				nextTokenFound = {keyword->second, lexeme, filename, line, column};
-			else
-				nextTokenFound = {TokenType::IDENTIFIER, lexeme, filename, line, column};
+			emitWord(charPos);
 
 			handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::ZERO>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::ZERO>(int nextChar)
 	{
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::ZERO);
 		if (nextChar == 'x' || nextChar == 'X' || nextChar == 'b' || nextChar == 'B' || nextChar == 'o' || nextChar == 'O')
 		{
 			state = LexerState::ZERO_PREFIX;
+			hexDigits = nextChar == 'x' || nextChar == 'X';
 		}
-		else if(isdigit(nextChar))
+		else if(Chars::is(nextChar, Chars::Digit))
 		{
 			state = LexerState::DIGITS;
+			skipTo(scan->digits(cur, end));
 		}
 		else if(nextChar == '.')
 		{
 			state = LexerState::FLOAT_LITERAL;
 		}
-		else if(isspace(nextChar) || ispunct(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space | Chars::Punct) || nextChar == EOF)
 		{
 			state = LexerState::START;
-			lexeme.pop_back();
-			nextTokenFound = {TokenType::INT_LITERAL, lexeme, filename, line, column};
-			handleState<LexerState::START>(nextChar);
+			if (emitLiteral(TokenType::INT_LITERAL, charPos))
+				handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::ZERO_PREFIX>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::ZERO_PREFIX>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isdigit(nextChar))
+		THREED_VISIT(LexerState::ZERO_PREFIX);
+		if (Chars::is(nextChar, hexDigits ? Chars::HexDigit : Chars::Digit))
 		{
 			state = LexerState::INT_LITERAL;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::INT_LITERAL>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::INT_LITERAL>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isdigit(nextChar))
+		THREED_VISIT(LexerState::INT_LITERAL);
+		// Binary and octal take every decimal digit here, decoding reports the ones out of range
+		if (Chars::is(nextChar, hexDigits ? Chars::HexDigit : Chars::Digit))
 		{
 			state = LexerState::INT_LITERAL;
+			if (!hexDigits)
+				skipTo(scan->digits(cur, end));
 		}
-		else if(isspace(nextChar) || (ispunct(nextChar) && nextChar != '.') || nextChar == EOF)
+		else if((Chars::is(nextChar, Chars::Space | Chars::Punct) && nextChar != '.') || nextChar == EOF)
 		{
 			state = LexerState::START;
-			lexeme.pop_back();
-
-			nextTokenFound = {TokenType::INT_LITERAL, lexeme, filename, line, column};
 
-			handleState<LexerState::START>(nextChar);
+			if (emitLiteral(TokenType::INT_LITERAL, charPos))
+				handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::SINGLE_QUOTE>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::SINGLE_QUOTE>(int nextChar)
 	{
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::SINGLE_QUOTE);
 		if (nextChar == '\\')
 		{
 			state = LexerState::CHAR_ESCAPE;
 		}
-		else if (nextChar == ' ' || isalnum(nextChar) )
+		else if (nextChar == ' ' || Chars::is(nextChar, Chars::Alpha | Chars::Digit))
 		{
 			state = LexerState::CHAR_LITERAL;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::CHAR_ESCAPE>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::CHAR_ESCAPE>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (escapeChars.find(nextChar) != escapeChars.end())
+		THREED_VISIT(LexerState::CHAR_ESCAPE);
+		if (Chars::is(nextChar, Chars::Escape))
 		{
 			state = LexerState::CHAR_LITERAL;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::CHAR_LITERAL>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::CHAR_LITERAL>(int nextChar)
 	{
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::CHAR_LITERAL);
 		if (nextChar == '\'')
 		{
 			state = LexerState::START;
-			nextTokenFound = {TokenType::CHAR_LITERAL, lexeme, filename, line, column};
+			emitLiteral(TokenType::CHAR_LITERAL, charPos + 1);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::DOUBLE_QUOTE>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::DOUBLE_QUOTE>(int nextChar)
 	{
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::DOUBLE_QUOTE);
+		// The body is decoded as it is scanned, a run at a time between escapes
+		literalTable.beginString();
+		stringRun = charPos;
 		if (nextChar == '\"')
 		{
 			state = LexerState::START;
-			nextTokenFound = {TokenType::STR_LITERAL, lexeme, filename, line, column};
+			emitLiteral(TokenType::STR_LITERAL, charPos + 1);
 			return true;
 		}
-		if (nextChar == ' ' || isalnum(nextChar) || ispunct(nextChar))
+		if (nextChar == '\\')
 		{
-			state = LexerState::STR_LITERAL;
+			state = LexerState::STR_ESCAPE;
 		}
-		else if (nextChar == '\\')
+		else if (Chars::is(nextChar, Chars::Printable))
 		{
-			state = LexerState::STR_ESCAPE;
+			state = LexerState::STR_LITERAL;
+			skipTo(scan->stringBody(cur, end));
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::STR_ESCAPE>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::STR_ESCAPE>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (escapeChars.find(nextChar) != escapeChars.end())
+		THREED_VISIT(LexerState::STR_ESCAPE);
+		if (Chars::is(nextChar, Chars::Escape))
 		{
 			state = LexerState::STR_LITERAL;
+			literalTable.appendString(LiteralTable::unescape(static_cast<char>(nextChar)));
+			stringRun = charPos + 1;
+			skipTo(scan->stringBody(cur, end));
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::STR_LITERAL>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::STR_LITERAL>(int nextChar)
 	{
-		lexeme += nextChar;
+		THREED_VISIT(LexerState::STR_LITERAL);
 		if (nextChar == '\\')
 		{
 			state = LexerState::STR_ESCAPE;
+			literalTable.appendString(stringRun, charPos);
 		}
 		else if (nextChar == '\"')
 		{
 			state = LexerState::START;
-			nextTokenFound = {TokenType::STR_LITERAL, lexeme, filename, line, column};
+			emitLiteral(TokenType::STR_LITERAL, charPos + 1);
 			return true;
 		}
-		else if (nextChar == ' ' || isalnum(nextChar) || ispunct(nextChar))
+		else if (Chars::is(nextChar, Chars::Printable))
 		{
 			state = LexerState::STR_LITERAL;
+			skipTo(scan->stringBody(cur, end));
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::DIGITS>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::DIGITS>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isdigit(nextChar))
+		THREED_VISIT(LexerState::DIGITS);
+		if (Chars::is(nextChar, Chars::Digit))
 		{
 			state = LexerState::DIGITS;
+			skipTo(scan->digits(cur, end));
 		}
 		else if(nextChar == '.')
 		{
 			state = LexerState::FLOAT_LITERAL;
 		}
-		else if(isspace(nextChar) || ispunct(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space | Chars::Punct) || nextChar == EOF)
 		{
 			state = LexerState::START;
-			lexeme.pop_back();
-			nextTokenFound = {TokenType::INT_LITERAL, lexeme, filename, line, column};
-			handleState<LexerState::START>(nextChar);
+			if (emitLiteral(TokenType::INT_LITERAL, charPos))
+				handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::FLOAT_LITERAL>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::FLOAT_LITERAL>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (isdigit(nextChar))
+		THREED_VISIT(LexerState::FLOAT_LITERAL);
+		if (Chars::is(nextChar, Chars::Digit))
 		{
 			state = LexerState::FLOAT_LITERAL;
+			skipTo(scan->digits(cur, end));
 		}
-		else if(isspace(nextChar) || ispunct(nextChar) || nextChar == EOF)
+		else if(Chars::is(nextChar, Chars::Space | Chars::Punct) || nextChar == EOF)
 		{
-			if (lexeme[lexeme.length() - 1] == '.')
+			if (nextChar == '.')
 			{
-				lexeme.pop_back();
-
-				auto curLine = curLineStream.str();
-				findAndReplaceAll(curLine, "\t", "    ");
-				findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-				std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-				std::cerr << " " << line << "|" << curLine << std::endl;
-				auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-				std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-				exit(1);
+				return unexpectedCharacter(nextChar);
 			}
 
 			state = LexerState::START;
-			lexeme.pop_back();
-			nextTokenFound = {TokenType::FLOAT_LITERAL, lexeme, filename, line, column};
-			handleState<LexerState::START>(nextChar);
+			if (emitLiteral(TokenType::FLOAT_LITERAL, charPos))
+				handleState<LexerState::START>(nextChar);
 			return true;
 		}
 		else
 		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return unexpectedCharacter(nextChar);
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::PUNCT>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::PUNCT>(int nextChar)
 	{
-		lexeme += nextChar;
-		if (lexeme == "//")
-		{
-			state = LexerState::LINE_COMMENT;
-		}
-		else if (lexeme == "/*")
-		{
-			state = LexerState::BLOCK_COMMENT;
-		}
-		else if (ispunct(nextChar))
-		{
-			auto pre = punctOpsPrefixes.find(lexeme);
-			if (pre != punctOpsPrefixes.end())
-			{
-				state = LexerState::PUNCT;
-				return false;
-			}
+		THREED_VISIT(LexerState::PUNCT);
+		auto& dfa = Operators::dfa;
 
-			lexeme.pop_back();
-			auto op = punctOps.find(lexeme);
-			if (op != punctOps.end())
+		// Longest match: keep going while the operator can be extended
+		auto next = dfa.next[punctState][static_cast<uint8_t>(nextChar)];
+		if (next != Operators::Dfa::dead)
+		{
+			switch (dfa.action[next])
 			{
-				state = LexerState::START;
-
-				nextTokenFound = {op->second, lexeme, filename, line, column};
-
-				handleState<LexerState::START>(nextChar);
-				return true;
+			case Operators::Action::LineComment:
+				state = LexerState::LINE_COMMENT;
+				skipTo(scan->lineComment(cur, end));
+				break;
+			case Operators::Action::BlockComment:
+				state = LexerState::BLOCK_COMMENT;
+				skipTo(scan->blockComment(cur, end));
+				break;
+			default:
+				punctState = next;
+				break;
 			}
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
-			
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
+			return false;
 		}
-		else if(isspace(nextChar) || isalnum(nextChar) || nextChar == '_' || nextChar == EOF)
+
+		// No operator starts with the first character, that character is the error
+		if (punctState == Operators::Dfa::dead)
 		{
-			lexeme.pop_back();
+			charPos = tokenStart;
+			return unexpectedCharacter(static_cast<uint8_t>(*tokenStart));
+		}
 
-			auto op = punctOps.find(lexeme);
-			if (op != punctOps.end())
+		if (Chars::is(nextChar, Chars::Punct | Chars::Space | Chars::Alpha | Chars::Digit) || nextChar == EOF)
+		{
+			if (dfa.action[punctState] == Operators::Action::Emit)
 			{
 				state = LexerState::START;
 
-				nextTokenFound = {op->second, lexeme, filename, line, column};
+				emit(dfa.type[punctState], charPos);
 
 				handleState<LexerState::START>(nextChar);
 				return true;
 			}
-			else
-			{
-				auto curLine = curLineStream.str();
-				findAndReplaceAll(curLine, "\t", "    ");
-				findAndReplaceAll(curLineWhitespace, "\t", "    ");
-				
-				std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-				std::cerr << " " << line << "|" << curLine << std::endl;
-				auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-				std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-				exit(1);
-			}
 		}
-		else
-		{
-			lexeme.pop_back();
-
-			auto curLine = curLineStream.str();
-			findAndReplaceAll(curLine, "\t", "    ");
-			findAndReplaceAll(curLineWhitespace, "\t", "    ");
 
-			std::cerr << filename << ":" << line << ":" << column << ": " << "error: Unexpected character: '" << nextChar << "'" << std::endl;
-			std::cerr << " " << line << "|" << curLine << std::endl;
-			auto whitespaces = std::string(std::to_string(line).length() + 1, ' ');
-			std::cout << curLineWhitespace << whitespaces << "^" << std::endl;
-
-			exit(1);
-		}
-		return false;
+		return unexpectedCharacter(nextChar);
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::LINE_COMMENT>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::LINE_COMMENT>(int nextChar)
 	{
-		if (nextChar == '\n' || nextChar == EOF)
+		THREED_VISIT(LexerState::LINE_COMMENT);
+		if (nextChar == '\n')
 		{
 			state = LexerState::START;
 			handleState<LexerState::START>(nextChar);
 			return false;
 		}
+		// The comment stays open at the end of the range, more of it may follow (see StreamLexer)
+		else if (nextChar == EOF)
+		{
+			return false;
+		}
 		else
 		{
+			skipTo(scan->lineComment(cur, end));
 			return false;
 		}
 		return false;
 	}
 
 	template<>
-	bool Lexer::handleState<Lexer::LexerState::BLOCK_COMMENT>(char nextChar)
+	bool Lexer::handleState<Lexer::LexerState::BLOCK_COMMENT>(int nextChar)
 	{
-		if (nextChar == '*' && curLineStream.peek() == '/')
+		THREED_VISIT(LexerState::BLOCK_COMMENT);
+		if (nextChar == '*' && cur != end && *cur == '/')
 		{
 			getNextChar();
 			state = LexerState::START;
 		}
+		else
+		{
+			skipTo(scan->blockComment(cur, end));
+		}
 		return false;
 	}
 
-	char Lexer::getNextChar()
+	void Lexer::emit(TokenType type, const char* tokenEnd)
+	{
+		auto offset = static_cast<uint32_t>(tokenStart - source.data());
+		uint32_t value = type == TokenType::BOOL_LITERAL && *tokenStart == 't';
+		nextTokenFound = {type, fileId, offset, static_cast<uint32_t>(tokenEnd - tokenStart), value};
+#ifdef THREED_INSTRUMENT
+		counters.tokens[static_cast<size_t>(type)]++;
+		counters.tokenBytes[static_cast<size_t>(type)] += nextTokenFound.length;
+#endif
+	}
+
+#ifdef THREED_INSTRUMENT
+	void Lexer::visit(LexerState visited)
 	{
-		column++;
-		char nextChar = curLineStream.get();
-		if (curLineStream.eof() && buffer.eof())
+		counters.stateVisits[static_cast<size_t>(visited)]++;
+		if (visited != lastVisited)
+			counters.transitions[static_cast<size_t>(lastVisited)][static_cast<size_t>(visited)]++;
+		lastVisited = visited;
+	}
+#endif
+
+	// Emits a keyword, or an identifier with its SymbolId as value
+	void Lexer::emitWord(const char* tokenEnd)
+	{
+		std::string_view word(tokenStart, static_cast<size_t>(tokenEnd - tokenStart));
+		auto type = Keywords::classify(word);
+		emit(type, tokenEnd);
+		if (type != TokenType::IDENTIFIER)
+			return;
+
+		// The word was just scanned, hashing it again reads it from L1
+		auto hash = contentHash(word);
+		if (symbolSink)
+		{
+			nextTokenFound.value = symbolSink->intern(word, hash);
+			return;
+		}
+
+		// Names new to this lexer are interned into sharedSymbols once, with its lock held
+		auto id = ownSymbols.intern(word, hash);
+		if (sharedSymbols)
 		{
-			column = 0;
-			curLineWhitespace.clear();
-			std::stringstream().swap(curLineStream);
-			return EOF;
+			if (id == sharedIds.size())
+				sharedIds.push_back(sharedSymbols->intern(word, hash));
+			id = sharedIds[id];
 		}
-		else if (curLineStream.eof())
+		nextTokenFound.value = id;
+	}
+
+	static const char* baseName(int base)
+	{
+		switch (base)
 		{
-			column = 0;
-			line++;
-			curLineWhitespace.clear();
-			std::string curLine;
-			std::getline(buffer, curLine);
-			std::stringstream().swap(curLineStream);
-			curLineStream << curLine;
-			return '\n';
+		case 2: return "binary";
+		case 8: return "octal";
+		case 16: return "hexadecimal";
+		default: return "decimal";
 		}
+	}
+
+	// Emits a literal token with its value decoded into literalTable. A value
+	// that does not fit, or a digit its base does not have, makes the token an
+	// ERROR instead. Returns false if that error stopped lexing.
+	bool Lexer::emitLiteral(TokenType type, const char* tokenEnd)
+	{
+		emit(type, tokenEnd);
+		auto first = tokenStart;
+		auto& token = nextTokenFound;
+
+		switch (type)
+		{
+		case TokenType::INT_LITERAL:
+		{
+			int base = 10;
+			if (tokenEnd - first > 2 && first[0] == '0' && !Chars::is(first[1], Chars::Digit))
+			{
+				base = first[1] == 'x' || first[1] == 'X' ? 16 : first[1] == 'b' || first[1] == 'B' ? 2 : 8;
+				first += 2;
+			}
+
+			uint64_t value;
+			auto [last, error] = std::from_chars(first, tokenEnd, value, base);
+			if (error == std::errc::result_out_of_range)
+				return literalError(tokenStart, "Integer literal does not fit in 64 bits");
+			if (last != tokenEnd)
+				return literalError(last, std::string("Invalid digit '") + *last + "' in " + baseName(base) + " literal");
+			token.value = literalTable.addInteger(value);
+			break;
+		}
+		case TokenType::FLOAT_LITERAL:
+		{
+			double value;
+			auto [last, error] = std::from_chars(first, tokenEnd, value);
+			if (error == std::errc::result_out_of_range)
+				return literalError(tokenStart, "Float literal out of range");
+			token.value = literalTable.addFloat(value);
+			break;
+		}
+		case TokenType::CHAR_LITERAL:
+			token.value = static_cast<uint8_t>(first[1] == '\\' ? LiteralTable::unescape(first[2]) : first[1]);
+			break;
+		case TokenType::STR_LITERAL:
+			literalTable.appendString(stringRun, tokenEnd - 1);
+			token.value = literalTable.endString();
+			break;
+		default:
+			break;
+		}
+		return true;
+	}
+
+	// Turns the literal just emitted into an ERROR token, the bytes it covers stay consumed
+	bool Lexer::literalError(const char* at, std::string message)
+	{
+		diagnostics().report(fileId, static_cast<uint32_t>(at - source.data()), std::move(message));
+		nextTokenFound.type = TokenType::ERROR;
+		nextTokenFound.value = 0;
+		if (recovery == Recovery::Stop)
+		{
+			cur = end;
+			return false;
+		}
+		return true;
+	}
+
+	// Consumes a run of characters that the current state would have consumed one
+	// at a time without emitting a token
+	void Lexer::skipTo(const char* runEnd)
+	{
+		THREED_COUNT_BYTES(runEnd - cur);
+		cur = runEnd;
+	}
+
+	// Only the position is tracked, lines and columns are found on demand
+	int Lexer::getNextChar()
+	{
+		THREED_SAMPLE_BEGIN(readClock);
+		charPos = cur;
+		int nextChar = cur == end ? EOF : static_cast<uint8_t>(*cur++);
+		THREED_SAMPLE_END(readSamples, readCycles);
+		THREED_COUNT_BYTES(nextChar != EOF);
 		return nextChar;
 	}
 
+#ifdef THREED_INSTRUMENT
+	// Times a sample of the tokens around the uninstrumented body below
 	Token Lexer::nextToken()
 	{
-		for (char nextChar = getNextChar();; nextChar = getNextChar())
-		{
-			if(isspace(nextChar))
-				curLineWhitespace += nextChar;
-			else
-				curLineWhitespace += ' ';
+		THREED_SAMPLE_BEGIN(tokenClock);
+		auto token = lexToken();
+		THREED_SAMPLE_END(tokenSamples, tokenCycles);
+		return token;
+	}
 
+	Token Lexer::lexToken()
+#else
+	Token Lexer::nextToken()
+#endif
+	{
+#if THREED_USE_COMPUTED_GOTO
+		// Every state ends in its own indirect jump to the next state, so the
+		// branch predictor learns per-state transitions instead of sharing one
+		// switch. The table must follow the order of LexerState.
+		static void* const dispatch[] = {
+			&&state_START,
+			&&state_ALPHA_UNDERSCORE,
+			&&state_IDENTIFIER,
+			&&state_ZERO,
+			&&state_ZERO_PREFIX,
+			&&state_INT_LITERAL,
+			&&state_SINGLE_QUOTE,
+			&&state_CHAR_ESCAPE,
+			&&state_CHAR_LITERAL,
+			&&state_DOUBLE_QUOTE,
+			&&state_STR_ESCAPE,
+			&&state_STR_LITERAL,
+			&&state_DIGITS,
+			&&state_FLOAT_LITERAL,
+			&&state_PUNCT,
+			&&state_LINE_COMMENT,
+			&&state_BLOCK_COMMENT,
+		};
+		static_assert(sizeof(dispatch) / sizeof(dispatch[0]) == static_cast<size_t>(LexerState::BLOCK_COMMENT) + 1,
+			"dispatch table does not cover every LexerState");
+
+		int nextChar = getNextChar();
+		goto *dispatch[static_cast<int>(state)];
+
+	#define THREED_NEXT_STATE()								\
+		if (nextChar == EOF)								\
+			goto endOfFile;									\
+		nextChar = getNextChar();							\
+		goto *dispatch[static_cast<int>(state)];
+
+	state_START:
+		if (handleState<LexerState::START>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_ALPHA_UNDERSCORE:
+		if (handleState<LexerState::ALPHA_UNDERSCORE>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_IDENTIFIER:
+		if (handleState<LexerState::IDENTIFIER>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_ZERO:
+		if (handleState<LexerState::ZERO>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_ZERO_PREFIX:
+		if (handleState<LexerState::ZERO_PREFIX>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_INT_LITERAL:
+		if (handleState<LexerState::INT_LITERAL>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_SINGLE_QUOTE:
+		if (handleState<LexerState::SINGLE_QUOTE>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_CHAR_ESCAPE:
+		if (handleState<LexerState::CHAR_ESCAPE>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_CHAR_LITERAL:
+		if (handleState<LexerState::CHAR_LITERAL>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_DOUBLE_QUOTE:
+		if (handleState<LexerState::DOUBLE_QUOTE>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_STR_ESCAPE:
+		if (handleState<LexerState::STR_ESCAPE>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_STR_LITERAL:
+		if (handleState<LexerState::STR_LITERAL>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_DIGITS:
+		if (handleState<LexerState::DIGITS>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_FLOAT_LITERAL:
+		if (handleState<LexerState::FLOAT_LITERAL>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_PUNCT:
+		if (handleState<LexerState::PUNCT>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_LINE_COMMENT:
+		if (handleState<LexerState::LINE_COMMENT>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+	state_BLOCK_COMMENT:
+		if (handleState<LexerState::BLOCK_COMMENT>(nextChar))
+			return nextTokenFound;
+		THREED_NEXT_STATE()
+
+	#undef THREED_NEXT_STATE
+
+	endOfFile:
+#else
+		for (int nextChar = getNextChar();; nextChar = getNextChar())
+		{
 			switch (state)
 			{
 			case LexerState::START:
@@ -837,9 +927,11 @@ namespace threeD { namespace Lexer {
 			if (nextChar == EOF)
 				break;
 		}
+#endif
 
 		// Return EOF token
-		nextTokenFound = {TokenType::EOF_, "", filename, line, column};
+		tokenStart = end;
+		emit(TokenType::EOF_, end);
 		return nextTokenFound;
 	}
 
@@ -848,4 +940,66 @@ namespace threeD { namespace Lexer {
 	{
 		return nextTokenFound;
 	}
+
+	Lexer::Checkpoint Lexer::checkpoint() const
+	{
+		return {cur, charPos, tokenStart, stringRun, nextTokenFound, &diagnostics(), diagnostics().size(), state, punctState, hexDigits};
+	}
+
+	void Lexer::restore(const Checkpoint& checkpoint)
+	{
+		assert(&diagnostics() == checkpoint.engine && diagnostics().size() >= checkpoint.diagnostics);
+		cur = checkpoint.cur;
+		charPos = checkpoint.charPos;
+		tokenStart = checkpoint.tokenStart;
+		stringRun = checkpoint.stringRun;
+		nextTokenFound = checkpoint.lastToken;
+		diagnostics().truncate(checkpoint.diagnostics);
+		state = checkpoint.state;
+		punctState = checkpoint.punctState;
+		hexDigits = checkpoint.hexDigits;
+	}
+
+	TokenStream Lexer::tokenizeAll()
+	{
+		TokenStream stream;
+		stream.file = fileId;
+		stream.reserve(TokenStream::estimateTokens(static_cast<size_t>(end - cur)));
+
+		for (auto token = nextToken(); token.type != TokenType::EOF_; token = nextToken())
+			stream.push(token);
+
+		stream.literals = std::move(literalTable);
+		literalTable.clear();
+		if (!symbolSink && !sharedSymbols)
+		{
+			stream.symbols = std::move(ownSymbols);
+			ownSymbols.clear();
+		}
+
+		return stream;
+	}
+
+	TokenStream tokenizeAll(SourceManager& sources, FileId file)
+	{
+		return Lexer(sources, file).tokenizeAll();
+	}
+
+	std::string_view Lexer::lexeme(const Token& token) const
+	{
+		if (token.file == fileId)
+			return token.lexeme(source);
+		return sources->lexeme(token);
+	}
+
+	SourceLocation Lexer::location(uint32_t offset) const
+	{
+		return sources->location(fileId, offset);
+	}
+
+	OwningToken Lexer::toOwning(const Token& token) const
+	{
+		auto start = location(token.offset);
+		return {token.type, std::string(lexeme(token)), std::string(sources->name(token.file)), start.line, start.column};
+	}
 }}
@@ -0,0 +1,31 @@
+#include "lexer/line_index.hpp"
+#include "scan.hpp"
+
+#include <algorithm>
+
+namespace threeD { namespace Lexer {
+
+	LineIndex::LineIndex(std::string_view source)
+		: source(source)
+	{
+		// Scripts average well over 16 bytes per line, longer lines grow it once
+		starts.reserve(source.size() / 16 + 1);
+		Scan::kernels().lineStarts(source.data(), source.data() + source.size(), starts);
+	}
+
+	SourceLocation LineIndex::location(uint32_t offset) const
+	{
+		// The line is the last start at or before offset
+		auto next = std::upper_bound(starts.begin(), starts.end(), offset);
+		auto line = static_cast<int>(next - starts.begin());
+		return {line, static_cast<int>(offset - *(next - 1)) + 1};
+	}
+
+	std::string_view LineIndex::lineText(int line) const
+	{
+		auto begin = starts[line - 1];
+		auto end = static_cast<size_t>(line) < starts.size() ? starts[line] - 1 : source.size();
+		return source.substr(begin, end - begin);
+	}
+
+}}
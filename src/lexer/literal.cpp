@@ -0,0 +1,73 @@
+#include "lexer/literal.hpp"
+
+namespace threeD { namespace Lexer {
+
+	uint32_t LiteralTable::addInteger(uint64_t value)
+	{
+		integers.push_back(value);
+		return static_cast<uint32_t>(integers.size() - 1);
+	}
+
+	uint32_t LiteralTable::addFloat(double value)
+	{
+		floats.push_back(value);
+		return static_cast<uint32_t>(floats.size() - 1);
+	}
+
+	uint32_t LiteralTable::endString()
+	{
+		stringStarts.push_back(static_cast<uint32_t>(arena.size()));
+		return static_cast<uint32_t>(stringStarts.size() - 2);
+	}
+
+	void LiteralTable::clear()
+	{
+		integers.clear();
+		floats.clear();
+		stringStarts.assign(1, 0);
+		arena.clear();
+	}
+
+	LiteralTable::Bases LiteralTable::append(const LiteralTable& other)
+	{
+		Bases bases = {static_cast<uint32_t>(integerCount()), static_cast<uint32_t>(floatCount()), static_cast<uint32_t>(stringCount())};
+		integers.insert(integers.end(), other.integers.begin(), other.integers.end());
+		floats.insert(floats.end(), other.floats.begin(), other.floats.end());
+
+		// Neither arena may keep the bytes of a string that was never ended
+		beginString();
+		auto arenaBase = static_cast<uint32_t>(arena.size());
+		for (size_t i = 1; i < other.stringStarts.size(); i++)
+			stringStarts.push_back(arenaBase + other.stringStarts[i]);
+		arena.append(other.arena, 0, other.stringStarts.back());
+		return bases;
+	}
+
+	uint32_t LiteralTable::rebase(TokenType type, uint32_t value, const Bases& bases)
+	{
+		switch (type)
+		{
+		case TokenType::INT_LITERAL: return value + bases.integers;
+		case TokenType::FLOAT_LITERAL: return value + bases.floats;
+		case TokenType::STR_LITERAL: return value + bases.strings;
+		default: return value;
+		}
+	}
+
+	char LiteralTable::unescape(char escape)
+	{
+		switch (escape)
+		{
+		case 'a': return '\a';
+		case 'b': return '\b';
+		case 'f': return '\f';
+		case 'n': return '\n';
+		case 'r': return '\r';
+		case 't': return '\t';
+		case 'v': return '\v';
+		case '0': return '\0';
+		default: return escape;		/* \' \" \? \\ */
+		}
+	}
+
+}}
@@ -0,0 +1,63 @@
+#include "lexer/lookahead.hpp"
+
+#include <cassert>
+
+namespace threeD { namespace Lexer {
+
+	TokenLookahead::TokenLookahead(Lexer& lexer, size_t capacity) : from(&lexer)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	// Lexes up to and including the token at index
+	void TokenLookahead::fill(uint64_t index)
+	{
+		while (lexed <= index)
+		{
+			// The oldest token still needed, the next one or the first one pinned
+			auto keep = marks > 0 ? pinned : read;
+			if (lexed - keep == slots.size())
+				grow(keep);
+
+			auto token = from->nextToken();
+			slots[lexed & mask] = {token.offset, token.length, token.value, token.type};
+			lexed++;
+		}
+	}
+
+	// Doubles the ring, every slot moves to where its index lands in the larger one
+	void TokenLookahead::grow(uint64_t keep)
+	{
+		std::vector<Slot> larger(slots.size() * 2);
+		auto largerMask = larger.size() - 1;
+		for (auto index = keep; index < lexed; index++)
+			larger[index & largerMask] = slots[index & mask];
+		slots = std::move(larger);
+		mask = largerMask;
+	}
+
+	TokenLookahead::Mark TokenLookahead::mark()
+	{
+		if (marks++ == 0)
+			pinned = read;
+		return {read};
+	}
+
+	void TokenLookahead::rewind(Mark m)
+	{
+		assert(marks > 0 && m.index >= pinned && m.index <= lexed);
+		read = m.index;
+	}
+
+	void TokenLookahead::release(Mark m)
+	{
+		assert(marks > 0 && m.index >= pinned);
+		(void)m;
+		marks--;
+	}
+
+}}
@@ -0,0 +1,127 @@
+#ifndef __OPERATORS_H__
+#define __OPERATORS_H__
+
+#include "lexer/token.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace threeD { namespace Lexer { namespace Operators {
+
+	// What reaching the end of a spelling means
+	enum class Action : uint8_t
+	{
+		None,			/* Only a prefix of longer spellings */
+		Emit,			/* An operator or punctuation token */
+		LineComment,	/* Opens a line comment */
+		BlockComment	/* Opens a block comment */
+	};
+
+	struct Operator
+	{
+		std::string_view spelling;
+		Action action;
+		TokenType type;
+	};
+
+	// Everything the PUNCT state recognises, the DFA below is generated from it
+	constexpr Operator list[] = {
+		{"+", 	Action::Emit, TokenType::ADD},
+		{"-", 	Action::Emit, TokenType::SUB},
+		{"*", 	Action::Emit, TokenType::MUL},
+		{"/", 	Action::Emit, TokenType::DIV},
+		{"%", 	Action::Emit, TokenType::MOD},
+		{"==", 	Action::Emit, TokenType::EQ},
+		{"!=", 	Action::Emit, TokenType::NEQ},
+		{"<", 	Action::Emit, TokenType::LT},
+		{"<=", 	Action::Emit, TokenType::LEQ},
+		{">", 	Action::Emit, TokenType::GT},
+		{">=", 	Action::Emit, TokenType::GEQ},
+		{"&&", 	Action::Emit, TokenType::AND},
+		{"||", 	Action::Emit, TokenType::OR},
+		{"!", 	Action::Emit, TokenType::NOT},
+		{":=", 	Action::Emit, TokenType::ASSIGN},
+		{"+=", 	Action::Emit, TokenType::ADD_ASSIGN},
+		{"-=", 	Action::Emit, TokenType::SUB_ASSIGN},
+		{"*=", 	Action::Emit, TokenType::MUL_ASSIGN},
+		{"/=", 	Action::Emit, TokenType::DIV_ASSIGN},
+		{"->", 	Action::Emit, TokenType::ARROW},
+		{"(", 	Action::Emit, TokenType::LPAREN},
+		{")", 	Action::Emit, TokenType::RPAREN},
+		{"{", 	Action::Emit, TokenType::LBRACE},
+		{"}", 	Action::Emit, TokenType::RBRACE},
+		{",", 	Action::Emit, TokenType::COMMA},
+		{";", 	Action::Emit, TokenType::SEMICOLON},
+		{"?", 	Action::Emit, TokenType::QUESTION},
+		{":", 	Action::Emit, TokenType::COLON},
+		{"//", 	Action::LineComment, TokenType::EOF_},
+		{"/*", 	Action::BlockComment, TokenType::EOF_},
+	};
+
+	constexpr size_t maxStates()
+	{
+		size_t states = 2;
+		for (auto& op : list)
+			states += op.spelling.size();
+		return states;
+	}
+
+	/*
+	 * One state per distinct prefix of the spellings above.
+	 * State 0 is dead (no prefix matches), state 1 is the empty prefix.
+	 * A zero transition means the spelling cannot be extended by that byte.
+	 */
+	struct Dfa
+	{
+		static constexpr uint8_t dead = 0;
+		static constexpr uint8_t root = 1;
+
+		uint8_t next[maxStates()][256];
+		Action action[maxStates()];
+		TokenType type[maxStates()];
+		size_t states;
+	};
+
+	static_assert(maxStates() <= 256, "Operator DFA states must fit in a byte");
+
+	constexpr Dfa build()
+	{
+		Dfa dfa = {};
+		dfa.states = 2;
+		for (auto& op : list)
+		{
+			size_t state = Dfa::root;
+			for (char c : op.spelling)
+			{
+				auto& target = dfa.next[state][static_cast<uint8_t>(c)];
+				if (target == Dfa::dead)
+					target = static_cast<uint8_t>(dfa.states++);
+				state = target;
+			}
+			dfa.action[state] = op.action;
+			dfa.type[state] = op.type;
+		}
+		return dfa;
+	}
+
+	constexpr Dfa dfa = build();
+
+	constexpr bool recognisesEveryOperator()
+	{
+		for (auto& op : list)
+		{
+			size_t state = Dfa::root;
+			for (char c : op.spelling)
+				state = dfa.next[state][static_cast<uint8_t>(c)];
+			if (dfa.action[state] != op.action || dfa.type[state] != op.type)
+				return false;
+		}
+		return true;
+	}
+
+	static_assert(recognisesEveryOperator(), "Operator DFA is inconsistent");
+
+}}}
+
+#endif // __OPERATORS_H__
@@ -0,0 +1,108 @@
+#include "lexer/pipeline.hpp"
+
+#include <utility>
+
+namespace threeD { namespace Lexer {
+
+	// Spins a little for the other thread to catch up, then gives its core away
+	static void backoff(unsigned spins)
+	{
+		if (spins >= 64)
+			std::this_thread::yield();
+	}
+
+	PipelinedLexer::PipelinedLexer(Lexer& lexer, size_t queueBatches)
+		: lexer(lexer), file(lexer.file()), queue(queueBatches)
+	{
+		worker = std::thread(&PipelinedLexer::produce, this);
+	}
+
+	PipelinedLexer::~PipelinedLexer()
+	{
+		stopping.store(true, std::memory_order_relaxed);
+		if (worker.joinable())
+			worker.join();
+	}
+
+	// Called when current is used up
+	Token PipelinedLexer::advance()
+	{
+		if (current->last)
+		{
+			if (error)
+				std::rethrow_exception(std::exchange(error, nullptr));
+			if (current->count > 0 && current->tokens[current->count - 1].type == TokenType::EOF_)
+				return current->tokens[current->count - 1].token(file);
+			return {TokenType::EOF_, file, static_cast<uint32_t>(lexer.sourceManager().contents(file).size()), 0, 0};
+		}
+
+		if (current != &empty)
+			queue.pop();
+		Batch* batch;
+		for (unsigned spins = 0; !(batch = queue.front()); spins++)
+		{
+			emptyWaits += spins == 0;
+			backoff(spins);
+		}
+		current = batch;
+		position = 0;
+
+		if (batch->last)
+		{
+			worker.join();
+			finished = true;
+		}
+		return next();
+	}
+
+	// nullptr if the consumer went away
+	PipelinedLexer::Batch* PipelinedLexer::waitForSpace()
+	{
+		Batch* batch;
+		for (unsigned spins = 0; !(batch = queue.back()); spins++)
+		{
+			if (stopping.load(std::memory_order_relaxed))
+				return nullptr;
+			fullWaits += spins == 0;
+			backoff(spins);
+		}
+		return batch;
+	}
+
+	// The lexer thread
+	void PipelinedLexer::produce()
+	{
+		Batch* batch = nullptr;
+		try
+		{
+			while (!stopping.load(std::memory_order_relaxed))
+			{
+				if (!(batch = waitForSpace()))
+					return;
+				batch->count = 0;
+				batch->last = false;
+				while (batch->count < batchTokens)
+				{
+					auto token = lexer.nextToken();
+					batch->tokens[batch->count++] = {token.offset, token.length, token.value, token.type};
+					if (token.type == TokenType::EOF_)
+					{
+						batch->last = true;
+						break;
+					}
+				}
+				queue.push();
+				if (batch->last)
+					return;
+			}
+		}
+		catch (...)
+		{
+			// nextToken() threw into the batch being filled, whose tokens still go out
+			error = std::current_exception();
+			batch->last = true;
+			queue.push();
+		}
+	}
+
+}}
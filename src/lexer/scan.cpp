@@ -0,0 +1,329 @@
+#include "scan.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define THREED_SCAN_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+#if defined(THREED_SCAN_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+	#define THREED_SCAN_AVX2 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define THREED_TARGET_AVX2
+	#else
+		#define THREED_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+/*
+ * The SIMD kernels classify 16 (SSE2) or 32 (AVX2) bytes at once into a
+ * "continues the run" mask and return the first byte outside of it.
+ * Loads never cross end, the last partial block is finished with the
+ * narrower kernel and then the scalar one.
+ *
+ * Ranges are tested with one signed compare: x + (128 - lo) maps [lo, hi]
+ * onto [-128, -128 + (hi - lo)].
+ */
+
+namespace threeD { namespace Lexer { namespace Scan {
+
+	static inline unsigned countTrailingZeros(unsigned mask)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+	}
+
+#ifdef THREED_SCAN_SSE2
+	static inline __m128i set16(int c) { return _mm_set1_epi8(static_cast<char>(c)); }
+	static inline __m128i eq16(__m128i x, int c) { return _mm_cmpeq_epi8(x, set16(c)); }
+	static inline __m128i inRange16(__m128i x, int lo, int hi)
+	{
+		return _mm_cmplt_epi8(_mm_add_epi8(x, set16(128 - lo)), set16(-128 + (hi - lo) + 1));
+	}
+#endif
+
+#ifdef THREED_SCAN_AVX2
+	THREED_TARGET_AVX2 static inline __m256i set32(int c) { return _mm256_set1_epi8(static_cast<char>(c)); }
+	THREED_TARGET_AVX2 static inline __m256i eq32(__m256i x, int c) { return _mm256_cmpeq_epi8(x, set32(c)); }
+	THREED_TARGET_AVX2 static inline __m256i inRange32(__m256i x, int lo, int hi)
+	{
+		return _mm256_cmpgt_epi8(set32(-128 + (hi - lo) + 1), _mm256_add_epi8(x, set32(128 - lo)));
+	}
+#endif
+
+	// Every class answers "does this byte continue the run" in scalar,
+	// SSE2 and AVX2 form; the vector forms return 0xFF lanes for members.
+
+	struct Identifier
+	{
+		static bool scalar(unsigned char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+		}
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x)
+		{
+			__m128i letter = inRange16(_mm_or_si128(x, set16(0x20)), 'a', 'z');
+			return _mm_or_si128(_mm_or_si128(letter, inRange16(x, '0', '9')), eq16(x, '_'));
+		}
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x)
+		{
+			__m256i letter = inRange32(_mm256_or_si256(x, set32(0x20)), 'a', 'z');
+			return _mm256_or_si256(_mm256_or_si256(letter, inRange32(x, '0', '9')), eq32(x, '_'));
+		}
+#endif
+	};
+
+	struct Digits
+	{
+		static bool scalar(unsigned char c) { return c >= '0' && c <= '9'; }
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x) { return inRange16(x, '0', '9'); }
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x) { return inRange32(x, '0', '9'); }
+#endif
+	};
+
+	struct Blanks
+	{
+		static bool scalar(unsigned char c) { return c == ' ' || (c >= '\t' && c <= '\r' && c != '\n'); }
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x)
+		{
+			return _mm_or_si128(_mm_andnot_si128(eq16(x, '\n'), inRange16(x, '\t', '\r')), eq16(x, ' '));
+		}
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x)
+		{
+			return _mm256_or_si256(_mm256_andnot_si256(eq32(x, '\n'), inRange32(x, '\t', '\r')), eq32(x, ' '));
+		}
+#endif
+	};
+
+	struct StringBody
+	{
+		static bool scalar(unsigned char c) { return c >= 0x20 && c <= 0x7E && c != '"' && c != '\\'; }
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x)
+		{
+			__m128i special = _mm_or_si128(eq16(x, '"'), eq16(x, '\\'));
+			return _mm_andnot_si128(special, inRange16(x, 0x20, 0x7E));
+		}
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x)
+		{
+			__m256i special = _mm256_or_si256(eq32(x, '"'), eq32(x, '\\'));
+			return _mm256_andnot_si256(special, inRange32(x, 0x20, 0x7E));
+		}
+#endif
+	};
+
+	struct LineComment
+	{
+		static bool scalar(unsigned char c) { return c != '\n'; }
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x) { return _mm_andnot_si128(eq16(x, '\n'), set16(0xFF)); }
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x) { return _mm256_andnot_si256(eq32(x, '\n'), set32(0xFF)); }
+#endif
+	};
+
+	struct BlockComment
+	{
+		static bool scalar(unsigned char c) { return c != '*' && c != '\n'; }
+#ifdef THREED_SCAN_SSE2
+		static __m128i sse2(__m128i x)
+		{
+			return _mm_andnot_si128(_mm_or_si128(eq16(x, '*'), eq16(x, '\n')), set16(0xFF));
+		}
+#endif
+#ifdef THREED_SCAN_AVX2
+		THREED_TARGET_AVX2 static __m256i avx2(__m256i x)
+		{
+			return _mm256_andnot_si256(_mm256_or_si256(eq32(x, '*'), eq32(x, '\n')), set32(0xFF));
+		}
+#endif
+	};
+
+	template<class Class>
+	static const char* scanScalar(const char* p, const char* end)
+	{
+		while (p != end && Class::scalar(static_cast<unsigned char>(*p)))
+			p++;
+		return p;
+	}
+
+#ifdef THREED_SCAN_SSE2
+	template<class Class>
+	static const char* scanSse2(const char* p, const char* end)
+	{
+		while (end - p >= 16)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(Class::sse2(block))) & 0xFFFF;
+			if (stop)
+				return p + countTrailingZeros(stop);
+			p += 16;
+		}
+		return scanScalar<Class>(p, end);
+	}
+#endif
+
+#ifdef THREED_SCAN_AVX2
+	template<class Class>
+	THREED_TARGET_AVX2 static const char* scanAvx2(const char* p, const char* end)
+	{
+		while (end - p >= 32)
+		{
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(Class::avx2(block)));
+			if (stop)
+				return p + countTrailingZeros(stop);
+			p += 32;
+		}
+		return scanSse2<Class>(p, end);
+	}
+#endif
+
+	// Newlines in [p, end), offsets counted from begin
+	static void lineStartsFrom(const char* begin, const char* p, const char* end, std::vector<uint32_t>& starts)
+	{
+		for (; p != end; p++)
+		{
+			if (*p == '\n')
+				starts.push_back(static_cast<uint32_t>(p - begin + 1));
+		}
+	}
+
+	static void lineStartsScalar(const char* begin, const char* end, std::vector<uint32_t>& starts)
+	{
+		lineStartsFrom(begin, begin, end, starts);
+	}
+
+	// One compare per block, then one push per set bit of the newline mask
+#ifdef THREED_SCAN_SSE2
+	static void lineStartsSse2(const char* begin, const char* end, std::vector<uint32_t>& starts)
+	{
+		const char* p = begin;
+		for (; end - p >= 16; p += 16)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			auto mask = static_cast<unsigned>(_mm_movemask_epi8(eq16(block, '\n')));
+			for (auto base = static_cast<uint32_t>(p - begin + 1); mask; mask &= mask - 1)
+				starts.push_back(base + countTrailingZeros(mask));
+		}
+		lineStartsFrom(begin, p, end, starts);
+	}
+#endif
+
+#ifdef THREED_SCAN_AVX2
+	THREED_TARGET_AVX2 static void lineStartsAvx2(const char* begin, const char* end, std::vector<uint32_t>& starts)
+	{
+		const char* p = begin;
+		for (; end - p >= 32; p += 32)
+		{
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			auto mask = static_cast<unsigned>(_mm256_movemask_epi8(eq32(block, '\n')));
+			for (auto base = static_cast<uint32_t>(p - begin + 1); mask; mask &= mask - 1)
+				starts.push_back(base + countTrailingZeros(mask));
+		}
+		lineStartsFrom(begin, p, end, starts);
+	}
+#endif
+
+	static bool cpuHasAvx2()
+	{
+#if !defined(THREED_SCAN_AVX2)
+		return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuid(info, 1);
+		bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		if (!osSavesYmm)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+	const Kernels& scalarKernels()
+	{
+		static const Kernels scalar = {
+			"scalar",
+			scanScalar<Identifier>,
+			scanScalar<Digits>,
+			scanScalar<Blanks>,
+			scanScalar<StringBody>,
+			scanScalar<LineComment>,
+			scanScalar<BlockComment>,
+			lineStartsScalar,
+		};
+		return scalar;
+	}
+
+	static const Kernels& selectKernels()
+	{
+		const char* forced = std::getenv("THREED_SIMD");
+		bool allowAvx2 = !forced || std::strcmp(forced, "avx2") == 0;
+		bool allowSse2 = allowAvx2 || std::strcmp(forced, "sse2") == 0;
+
+#ifdef THREED_SCAN_AVX2
+		static const Kernels avx2 = {
+			"avx2",
+			scanAvx2<Identifier>,
+			scanAvx2<Digits>,
+			scanAvx2<Blanks>,
+			scanAvx2<StringBody>,
+			scanAvx2<LineComment>,
+			scanAvx2<BlockComment>,
+			lineStartsAvx2,
+		};
+		if (allowAvx2 && cpuHasAvx2())
+			return avx2;
+#endif
+#ifdef THREED_SCAN_SSE2
+		static const Kernels sse2 = {
+			"sse2",
+			scanSse2<Identifier>,
+			scanSse2<Digits>,
+			scanSse2<Blanks>,
+			scanSse2<StringBody>,
+			scanSse2<LineComment>,
+			scanSse2<BlockComment>,
+			lineStartsSse2,
+		};
+		if (allowSse2)
+			return sse2;
+#endif
+		(void)allowSse2;
+		return scalarKernels();
+	}
+
+	const Kernels& kernels()
+	{
+		static const Kernels& selected = selectKernels();
+		return selected;
+	}
+
+}}}
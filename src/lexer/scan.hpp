@@ -0,0 +1,34 @@
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <cstdint>
+#include <vector>
+
+namespace threeD { namespace Lexer { namespace Scan {
+
+	// Each kernel returns the first position in [p, end) whose byte does not
+	// continue the run, or end. None of the runs contain '\n', so line
+	// bookkeeping stays with Lexer::getNextChar().
+	struct Kernels
+	{
+		const char* name;
+		const char* (*identifier)(const char* p, const char* end);		/* [A-Za-z0-9_] */
+		const char* (*digits)(const char* p, const char* end);			/* [0-9] */
+		const char* (*blanks)(const char* p, const char* end);			/* ' ', \t, \v, \f, \r */
+		const char* (*stringBody)(const char* p, const char* end);		/* printable except " and \ */
+		const char* (*lineComment)(const char* p, const char* end);		/* anything but \n */
+		const char* (*blockComment)(const char* p, const char* end);	/* anything but * and \n */
+
+		// Appends the offset from begin of the byte after every '\n' in [begin, end)
+		void (*lineStarts)(const char* begin, const char* end, std::vector<uint32_t>& starts);
+	};
+
+	// Best kernels the CPU supports, chosen on first use.
+	// Setting THREED_SIMD to scalar, sse2 or avx2 overrides the choice.
+	const Kernels& kernels();
+
+	const Kernels& scalarKernels();
+
+}}}
+
+#endif // __SCAN_H__
@@ -0,0 +1,159 @@
+#include "lexer/source.hpp"
+
+#include <iterator>
+#include <utility>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace threeD { namespace Lexer {
+
+	SourceBuffer::SourceBuffer(std::string_view view) : view_(view)
+	{
+	}
+
+	SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+		bool ownsBytes = !other.owned.empty() && other.view_.data() == other.owned.data();
+		owned = std::move(other.owned);
+		// Moving a short string does not keep its address, so re-point the view
+		view_ = ownsBytes ? std::string_view(owned) : other.view_;
+		mapping = std::exchange(other.mapping, nullptr);
+		mappingSize = std::exchange(other.mappingSize, 0);
+		open = other.open;
+		other.view_ = {};
+		return *this;
+	}
+
+	SourceBuffer::~SourceBuffer()
+	{
+		release();
+	}
+
+	void SourceBuffer::release()
+	{
+		if (mapping)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(mapping);
+#else
+			munmap(mapping, mappingSize);
+#endif
+		}
+		mapping = nullptr;
+		mappingSize = 0;
+		view_ = {};
+		owned.clear();
+	}
+
+	SourceBuffer SourceBuffer::fromFile(const std::string& path)
+	{
+		SourceBuffer result;
+		result.open = false;
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return result;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return result;
+		}
+
+		result.open = true;
+		// Empty files cannot be mapped, an empty view is all we need
+		if (size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return result;
+		}
+
+		HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!fileMapping)
+		{
+			result.open = false;
+			return result;
+		}
+
+		void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(fileMapping);
+		if (!view)
+		{
+			result.open = false;
+			return result;
+		}
+		size_t fileSize = static_cast<size_t>(size.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return result;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+		{
+			::close(fd);
+			return result;
+		}
+
+		result.open = true;
+		// Empty files cannot be mapped, an empty view is all we need
+		if (st.st_size == 0)
+		{
+			::close(fd);
+			return result;
+		}
+
+		void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED)
+		{
+			result.open = false;
+			return result;
+		}
+		size_t fileSize = static_cast<size_t>(st.st_size);
+		madvise(view, fileSize, MADV_SEQUENTIAL);
+#endif
+
+		result.mapping = view;
+		result.mappingSize = fileSize;
+		result.view_ = std::string_view(static_cast<const char*>(view), result.mappingSize);
+		return result;
+	}
+
+	SourceBuffer SourceBuffer::fromStream(std::istream& stream)
+	{
+		return fromString(std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+	}
+
+	SourceBuffer SourceBuffer::fromString(std::string contents)
+	{
+		SourceBuffer result;
+		result.owned = std::move(contents);
+		result.view_ = result.owned;
+		return result;
+	}
+
+}}
@@ -0,0 +1,128 @@
+#include "lexer/source_manager.hpp"
+
+#include <mutex>
+#include <utility>
+
+namespace threeD { namespace Lexer {
+
+	static bool fits(std::string_view name, const SourceBuffer& buffer, DiagnosticEngine* diagnostics)
+	{
+		if (buffer.size() <= SourceManager::maxFileSize)
+			return true;
+		if (diagnostics)
+			diagnostics->report(InvalidFileId, 0, std::string(name) + " is 4 GiB or larger, a source file must be smaller");
+		return false;
+	}
+
+	FileId SourceManager::addFile(const std::string& path, DiagnosticEngine* diagnostics)
+	{
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto found = pathToFile.find(path);
+			if (found != pathToFile.end())
+				return found->second;
+		}
+
+		// Map outside the lock, registering other files should not wait on the disk
+		auto buffer = SourceBuffer::fromFile(path);
+		if (!buffer.isOpen())
+		{
+			if (diagnostics)
+				diagnostics->report(InvalidFileId, 0, "Could not open " + path);
+			return InvalidFileId;
+		}
+		if (!fits(path, buffer, diagnostics))
+			return InvalidFileId;
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		// Another thread may have registered the path in the meantime
+		auto found = pathToFile.find(path);
+		if (found != pathToFile.end())
+			return found->second;
+
+		auto file = append(path, std::move(buffer), diagnostics);
+		if (file != InvalidFileId)
+			pathToFile.emplace(path, file);
+		return file;
+	}
+
+	FileId SourceManager::addBuffer(std::string name, SourceBuffer buffer, DiagnosticEngine* diagnostics)
+	{
+		if (!fits(name, buffer, diagnostics))
+			return InvalidFileId;
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		return append(std::move(name), std::move(buffer), diagnostics);
+	}
+
+	FileId SourceManager::append(std::string name, SourceBuffer buffer, DiagnosticEngine* diagnostics)
+	{
+		if (files.size() >= maxFiles)
+		{
+			if (diagnostics)
+				diagnostics->report(InvalidFileId, 0, "Too many source files, " + name + " is past the " + std::to_string(maxFiles) + " a SourceManager holds");
+			return InvalidFileId;
+		}
+		auto file = static_cast<FileId>(files.size());
+		files.push_back({std::move(name), std::move(buffer), std::make_unique<Lines>()});
+		return file;
+	}
+
+	bool SourceManager::replace(FileId file, SourceBuffer buffer, DiagnosticEngine* diagnostics)
+	{
+		if (!fits(name(file), buffer, diagnostics))
+			return false;
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto& entry = files.at(file);
+		entry.buffer = std::move(buffer);
+		entry.lines = std::make_unique<Lines>();
+		return true;
+	}
+
+	const SourceManager::File& SourceManager::get(FileId file) const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return files.at(file);
+	}
+
+	std::string_view SourceManager::name(FileId file) const
+	{
+		return get(file).name;
+	}
+
+	std::string_view SourceManager::contents(FileId file) const
+	{
+		return get(file).buffer.view();
+	}
+
+	std::string_view SourceManager::lexeme(const Token& token) const
+	{
+		return token.lexeme(contents(token.file));
+	}
+
+	const LineIndex& SourceManager::lines(FileId file) const
+	{
+		auto& entry = get(file);
+		std::call_once(entry.lines->built, [&] { entry.lines->index = LineIndex(entry.buffer.view()); });
+		return entry.lines->index;
+	}
+
+	SourceLocation SourceManager::location(FileId file, uint32_t offset) const
+	{
+		return lines(file).location(offset);
+	}
+
+	size_t SourceManager::fileCount() const
+	{
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		return files.size();
+	}
+
+	SourceManager& SourceManager::global()
+	{
+		static SourceManager instance;
+		return instance;
+	}
+
+}}
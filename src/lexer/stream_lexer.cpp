@@ -0,0 +1,228 @@
+#include "lexer/stream_lexer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace threeD { namespace Lexer {
+
+	StreamLexer::StreamLexer(Callback onToken, size_t capacity, std::string name)
+		: onToken(std::move(onToken)), capacity(std::min<size_t>(std::max<size_t>(capacity, 2), UINT32_MAX)), name(std::move(name))
+	{
+		buffer.reset(new char[this->capacity]);
+		file = sources.addBuffer(this->name, SourceBuffer(std::string_view(buffer.get(), this->capacity)));
+	}
+
+	void StreamLexer::feed(const char* data, size_t size)
+	{
+		while (size > 0 && !halted)
+		{
+			makeRoom();
+			auto count = std::min(size, capacity - filled);
+			std::memcpy(buffer.get() + filled, data, count);
+			data += count;
+			size -= count;
+			advance(count);
+		}
+	}
+
+	void StreamLexer::finish()
+	{
+		if (finished)
+			return;
+		finished = true;
+		if (!halted && !skippingLine)
+			lexWindow(true);
+	}
+
+	void StreamLexer::lex(int fd)
+	{
+		while (!halted)
+		{
+			makeRoom();
+#ifdef _WIN32
+			auto count = _read(fd, buffer.get() + filled, static_cast<unsigned>(std::min<size_t>(capacity - filled, INT32_MAX)));
+#else
+			auto count = ::read(fd, buffer.get() + filled, capacity - filled);
+#endif
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count < 0)
+				found.report(InvalidFileId, 0, "Could not read " + name + ": " + std::strerror(errno));
+			if (count <= 0)
+				break;
+			advance(static_cast<size_t>(count));
+		}
+		finish();
+	}
+
+	// Lexed bytes are only dropped once they take half the buffer, so reads stay large
+	void StreamLexer::makeRoom()
+	{
+		if (begin > 0 && (filled == capacity || begin >= capacity / 2))
+			drop(begin);
+		if (filled == capacity)
+			tooLong();
+	}
+
+	void StreamLexer::advance(size_t size)
+	{
+		filled += size;
+		if (halted)
+		{
+			begin = filled;
+			return;
+		}
+
+		if (skippingLine)
+		{
+			auto newline = static_cast<const char*>(std::memchr(buffer.get() + begin, '\n', filled - begin));
+			if (!newline)
+			{
+				begin = filled;
+				return;
+			}
+			begin = static_cast<size_t>(newline - buffer.get());
+			skippingLine = false;
+		}
+		lexWindow(false);
+	}
+
+	/*
+	 * Lexes [begin, filled) and delivers every token that cannot change with
+	 * more input. Unless this is the last window:
+	 *  - a token that ends at the end of the window is held back, its next
+	 *    character (or the one that makes it an error) has not arrived yet;
+	 *  - a trailing '*' is held back, in a block comment the '/' after it
+	 *    decides whether the comment ends.
+	 * Lexing picks up at the first token held back, in START, or else at the
+	 * end of the window in the state the lexer ended in.
+	 */
+	void StreamLexer::lexWindow(bool last)
+	{
+		auto windowEnd = filled;
+		if (!last && windowEnd > begin && buffer[windowEnd - 1] == '*')
+			windowEnd--;
+		if (windowEnd == begin)
+			return;
+
+		DiagnosticEngine errors;
+		Lexer lexer(sources, file, static_cast<uint32_t>(begin), static_cast<uint32_t>(windowEnd), entry);
+		lexer.reportTo(errors);
+		lexer.setRecovery(recovery);
+
+		// Each token is delivered once the next one shows it was not the last
+		size_t errorsDelivered = 0;
+		Token held = lexer.nextToken();
+		while (held.type != TokenType::EOF_)
+		{
+			auto next = lexer.nextToken();
+			if (next.type == TokenType::EOF_ && !last && held.offset + held.length == windowEnd)
+				break;
+
+			deliver(held, &lexer.literals(), &lexer.symbols());
+			if (held.type == TokenType::ERROR)
+				errorsDelivered++;
+			held = next;
+		}
+
+		// Diagnostics come in the order of the ERROR tokens, one each
+		errors.truncate(errorsDelivered);
+		for (auto& error : errors.all())
+			report(error.offset, error.message);
+
+		if (recovery == Recovery::Stop && errorsDelivered > 0)
+		{
+			halted = true;
+			begin = filled;
+			return;
+		}
+
+		if (held.type != TokenType::EOF_)
+		{
+			begin = held.offset;
+			entry = Lexer::LexerState::START;
+		}
+		else
+		{
+			begin = windowEnd;
+			entry = lexer.currentState();
+		}
+	}
+
+	void StreamLexer::tooLong()
+	{
+		report(0, "Token longer than the " + std::to_string(capacity) + " byte stream buffer");
+		deliver({TokenType::ERROR, file, 0, static_cast<uint32_t>(filled), 0}, nullptr, nullptr);
+		entry = Lexer::LexerState::START;
+		begin = filled;
+		if (recovery == Recovery::Stop)
+			halted = true;
+		else
+			skippingLine = true;
+		drop(filled);
+	}
+
+	// Drops the first size bytes, counting the lines in them
+	void StreamLexer::drop(size_t size)
+	{
+		auto first = buffer.get();
+		auto last = first + size;
+		line += static_cast<uint64_t>(std::count(first, last, '\n'));
+		for (auto p = last; p != first; p--)
+		{
+			if (p[-1] == '\n')
+			{
+				lineStart = base + static_cast<uint64_t>(p - first);
+				break;
+			}
+		}
+
+		std::memmove(first, last, filled - size);
+		base += size;
+		filled -= size;
+		begin -= size;
+	}
+
+	void StreamLexer::report(size_t at, const std::string& message)
+	{
+		if (found.size() >= diagnosticLimit)
+		{
+			dropped++;
+			return;
+		}
+
+		auto first = buffer.get();
+		auto errorLine = line + static_cast<uint64_t>(std::count(first, first + at, '\n'));
+		auto errorLineStart = lineStart;
+		for (auto p = first + at; p != first; p--)
+		{
+			if (p[-1] == '\n')
+			{
+				errorLineStart = base + static_cast<uint64_t>(p - first);
+				break;
+			}
+		}
+
+		auto column = base + at - errorLineStart + 1;
+		found.report(InvalidFileId, 0, name + ":" + std::to_string(errorLine) + ":" + std::to_string(column) + ": " + message);
+	}
+
+	// names is the window lexer's own table, only names that are delivered reach symbolSink
+	void StreamLexer::deliver(const Token& token, const LiteralTable* literals, const SymbolTable* names)
+	{
+		delivered++;
+		auto value = token.value;
+		if (token.type == TokenType::IDENTIFIER)
+			value = symbolSink ? symbolSink->intern(names->name(value), names->hash(value)) : InvalidSymbolId;
+		onToken({token.type, base + token.offset, std::string_view(buffer.get() + token.offset, token.length), value, literals});
+	}
+
+}}
@@ -0,0 +1,102 @@
+#include "lexer/symbol.hpp"
+
+namespace threeD { namespace Lexer {
+
+	SymbolId SymbolTable::intern(std::string_view name, uint64_t hash)
+	{
+		if (hashes.size() * 2 >= slots.size())
+			grow();
+
+		auto mask = slots.size() - 1;
+		auto low = static_cast<uint32_t>(hash);
+		for (auto i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+		{
+			auto& slot = slots[i];
+			if (slot.id == InvalidSymbolId)
+			{
+				slot = {low, static_cast<SymbolId>(hashes.size())};
+				hashes.push_back(hash);
+				arena.append(name.data(), name.size());
+				starts.push_back(static_cast<uint32_t>(arena.size()));
+				return slot.id;
+			}
+			if (slot.hash == low && spells(slot.id, name))
+				return slot.id;
+		}
+	}
+
+	SymbolId SymbolTable::find(std::string_view name) const
+	{
+		if (slots.empty())
+			return InvalidSymbolId;
+
+		auto hash = contentHash(name);
+		auto mask = slots.size() - 1;
+		auto low = static_cast<uint32_t>(hash);
+		for (auto i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask)
+		{
+			auto& slot = slots[i];
+			if (slot.id == InvalidSymbolId)
+				return InvalidSymbolId;
+			if (slot.hash == low && spells(slot.id, name))
+				return slot.id;
+		}
+	}
+
+	void SymbolTable::grow()
+	{
+		std::vector<Slot> larger(slots.empty() ? 64 : slots.size() * 2, {0, InvalidSymbolId});
+		auto mask = larger.size() - 1;
+		for (SymbolId id = 0; id < hashes.size(); id++)
+		{
+			auto i = static_cast<size_t>(hashes[id]) & mask;
+			while (larger[i].id != InvalidSymbolId)
+				i = (i + 1) & mask;
+			larger[i] = {static_cast<uint32_t>(hashes[id]), id};
+		}
+		slots = std::move(larger);
+	}
+
+	void SymbolTable::clear()
+	{
+		slots.clear();
+		hashes.clear();
+		starts.assign(1, 0);
+		arena.clear();
+	}
+
+	std::vector<SymbolId> SymbolTable::append(const SymbolTable& other)
+	{
+		std::vector<SymbolId> ids(other.size());
+		for (SymbolId id = 0; id < other.size(); id++)
+			ids[id] = intern(other.name(id), other.hashes[id]);
+		return ids;
+	}
+
+	SymbolId ConcurrentSymbolTable::intern(std::string_view name, uint64_t hash)
+	{
+		auto index = shardOf(hash);
+		auto& shard = shards[index];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return shard.table.intern(name, hash) << shardBits | static_cast<SymbolId>(index);
+	}
+
+	std::string ConcurrentSymbolTable::name(SymbolId id) const
+	{
+		auto& shard = shards[id & ((1u << shardBits) - 1)];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return std::string(shard.table.name(id >> shardBits));
+	}
+
+	size_t ConcurrentSymbolTable::size() const
+	{
+		size_t total = 0;
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			total += shard.table.size();
+		}
+		return total;
+	}
+
+}}
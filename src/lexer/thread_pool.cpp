@@ -0,0 +1,141 @@
+#include "lexer/thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace threeD { namespace Lexer {
+
+	ThreadPool::ThreadPool(unsigned workers)
+	{
+		if (workers == 0)
+			workers = std::max(1u, std::thread::hardware_concurrency());
+
+		for (unsigned i = 0; i < workers; i++)
+			queues.push_back(std::make_unique<Queue>());
+
+		// Worker 0 is whichever thread calls run()
+		for (unsigned i = 1; i < workers; i++)
+			threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	void ThreadPool::run(const std::vector<size_t>& items, const std::function<void(size_t)>& task)
+	{
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			auto& queue = *queues[i % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.items.push_back(items[i]);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->task = &task;
+			busy = static_cast<unsigned>(threads.size());
+			error = nullptr;
+			failed = false;
+			generation++;
+		}
+		wake.notify_all();
+
+		drain(0);
+
+		// Even after a throw, task must outlive every call still running
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [this] { return busy == 0; });
+		this->task = nullptr;
+		if (!error)
+			return;
+
+		// Items never taken would otherwise start the next run
+		for (auto& queue : queues)
+		{
+			std::lock_guard<std::mutex> queueLock(queue->mutex);
+			queue->items.clear();
+		}
+		std::rethrow_exception(std::exchange(error, nullptr));
+	}
+
+	bool ThreadPool::take(unsigned worker, size_t& item)
+	{
+		// Own queue first, in the order the items were dealt
+		{
+			auto& queue = *queues[worker];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.items.empty())
+			{
+				item = queue.items.front();
+				queue.items.pop_front();
+				return true;
+			}
+		}
+
+		// Then steal from the other end of another worker's queue, the cheapest
+		// item it has left, which fills the gap without creating a new straggler
+		for (size_t i = 1; i < queues.size(); i++)
+		{
+			auto& queue = *queues[(worker + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.items.empty())
+			{
+				item = queue.items.back();
+				queue.items.pop_back();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ThreadPool::drain(unsigned worker)
+	{
+		// Items are only added before a run starts, so once every queue is
+		// empty there is nothing left for this worker to do
+		size_t item;
+		while (!failed.load(std::memory_order_relaxed) && take(worker, item))
+		{
+			try
+			{
+				(*task)(item);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+					error = std::current_exception();
+				failed = true;
+			}
+		}
+	}
+
+	void ThreadPool::workerLoop(unsigned worker)
+	{
+		uint64_t seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			drain(worker);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				finished.notify_one();
+		}
+	}
+
+}}
@@ -8,6 +8,9 @@ namespace threeD { namespace Lexer {
 		case TokenType::EOF_:
 			out << "EOF_";
 			break;
+		case TokenType::ERROR:
+			out << "ERROR";
+			break;
 		case TokenType::IDENTIFIER:
 			out << "IDENTIFIER";
 			break;
@@ -0,0 +1,372 @@
+#include "lexer/token_cache.hpp"
+#include "lexer/lexer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace threeD { namespace Lexer {
+
+	namespace fs = std::filesystem;
+
+	// Changes with the layout of entries
+	constexpr uint32_t cacheFormat = 4;
+	constexpr char cacheMagic[4] = {'3', 'D', 'T', 'C'};
+	constexpr const char* entryExtension = ".tks";
+
+	// Stored as is, so entries only match on machines of the same byte order
+	struct CacheHeader
+	{
+		char magic[4];
+		uint32_t format;
+		uint32_t lexer;			/* lexerVersion */
+		uint32_t recovery;
+		uint64_t sourceHash;
+		uint64_t sourceSize;
+		uint32_t tokens;
+		uint32_t diagnostics;	/* Each an offset, a message length and the message */
+		uint32_t integers;		/* Sizes of the literal table */
+		uint32_t floats;
+		uint32_t strings;
+		uint32_t arena;
+		uint32_t symbols;		/* The arrays of a SymbolTable: its hashes, starts, slots and arena */
+		uint32_t symbolSlots;
+		uint32_t symbolBytes;
+		uint32_t reserved;		/* Zero, rounds the header up to 8 bytes */
+	};
+
+	static_assert(sizeof(CacheHeader) == 72, "CacheHeader has padding");
+	static_assert(sizeof(TokenType) == 1, "Cache entries store one byte per token type");
+
+	TokenCache::TokenCache(std::string directory, uint64_t budget) : root(std::move(directory)), budget(budget)
+	{
+		std::error_code error;
+		fs::create_directories(root, error);
+		evict();
+	}
+
+	std::string TokenCache::entryPath(uint64_t key) const
+	{
+		static const char hex[] = "0123456789abcdef";
+		std::string name(16, '0');
+		for (int i = 15; i >= 0; i--, key >>= 4)
+			name[i] = hex[key & 15];
+		return (fs::path(root) / (name + entryExtension)).string();
+	}
+
+	// Whether every token lies within the source and its value within its table.
+	// An entry can pass every header check and still be corrupt, or be written
+	// by a lexer that changed without bumping lexerVersion.
+	static bool inBounds(const TokenStreamView& tokens, size_t sourceSize)
+	{
+		for (size_t i = 0; i < tokens.size(); i++)
+		{
+			auto value = tokens.values[i];
+			if (tokens.offsets[i] > sourceSize || tokens.lengths[i] > sourceSize - tokens.offsets[i])
+				return false;
+			switch (tokens.types[i])
+			{
+			case TokenType::IDENTIFIER:
+				if (value >= tokens.symbols->size())
+					return false;
+				break;
+			case TokenType::INT_LITERAL:
+				if (value >= tokens.literals->integerCount())
+					return false;
+				break;
+			case TokenType::FLOAT_LITERAL:
+				if (value >= tokens.literals->floatCount())
+					return false;
+				break;
+			case TokenType::STR_LITERAL:
+				if (value >= tokens.literals->stringCount())
+					return false;
+				break;
+			case TokenType::CHAR_LITERAL:
+				if (value > UINT8_MAX)
+					return false;
+				break;
+			case TokenType::BOOL_LITERAL:
+				if (value > 1)
+					return false;
+				break;
+			default:
+				// TokenType::COLON is the last type
+				if (tokens.types[i] > TokenType::COLON || value != 0)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool TokenCache::load(const std::string& path, uint64_t hash, std::string_view source, Recovery recovery, FileId file, CachedTokens& result)
+	{
+		auto entry = SourceBuffer::fromFile(path);
+		if (!entry.isOpen() || entry.size() < sizeof(CacheHeader))
+			return false;
+
+		CacheHeader header;
+		std::memcpy(&header, entry.data(), sizeof(header));
+		if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.format != cacheFormat
+			|| header.lexer != lexerVersion || header.recovery != static_cast<uint32_t>(recovery)
+			|| header.sourceHash != hash || header.sourceSize != source.size())
+			return false;
+
+		// The arrays are checked to fit here, every token once they are mapped
+		size_t arrays = sizeof(CacheHeader) + size_t(header.tokens) * (3 * sizeof(uint32_t) + sizeof(TokenType));
+		size_t literals = size_t(header.integers) * sizeof(uint64_t) + size_t(header.floats) * sizeof(double)
+			+ (size_t(header.strings) + 1) * sizeof(uint32_t) + header.arena;
+		size_t symbols = size_t(header.symbols) * (sizeof(uint64_t) + sizeof(uint32_t)) + sizeof(uint32_t)
+			+ size_t(header.symbolSlots) * sizeof(SymbolTable::Slot) + header.symbolBytes;
+		if (arrays + literals + symbols > entry.size())
+			return false;
+
+		// The literal and symbol tables are copied, unlike the arrays they have to grow on relex.
+		// Both are stored as they are laid out in memory, so a load is a handful of memcpys.
+		auto table = std::make_unique<LiteralTable>();
+		auto copy = [](auto& into, size_t count, const char*& from) {
+			into.resize(count);
+			std::memcpy(into.data(), from, count * sizeof(into[0]));
+			from += count * sizeof(into[0]);
+		};
+		auto at = entry.data() + arrays;
+		copy(table->integers, header.integers, at);
+		copy(table->floats, header.floats, at);
+		copy(table->stringStarts, size_t(header.strings) + 1, at);
+		copy(table->arena, header.arena, at);
+		if (table->stringStarts.front() != 0 || table->stringStarts.back() != header.arena
+			|| !std::is_sorted(table->stringStarts.begin(), table->stringStarts.end()))
+			return false;
+
+		// The hash table comes back slot for slot, no name is hashed or interned again.
+		// What intern() and find() rely on is checked: a power of two at most half
+		// full, ids in range and names within the arena.
+		auto names = std::make_unique<SymbolTable>();
+		copy(names->hashes, header.symbols, at);
+		copy(names->starts, size_t(header.symbols) + 1, at);
+		copy(names->slots, header.symbolSlots, at);
+		copy(names->arena, header.symbolBytes, at);
+		auto slots = header.symbolSlots;
+		if ((slots & (slots - 1)) != 0 || size_t(header.symbols) * 2 > slots
+			|| names->starts.front() != 0 || names->starts.back() != header.symbolBytes
+			|| !std::is_sorted(names->starts.begin(), names->starts.end())
+			|| std::any_of(names->slots.begin(), names->slots.end(), [&](const SymbolTable::Slot& slot) {
+				return slot.id >= header.symbols && slot.id != InvalidSymbolId;
+			}))
+			return false;
+
+		auto end = entry.data() + entry.size();
+		for (uint32_t i = 0; i < header.diagnostics; i++)
+		{
+			uint32_t fields[2];
+			if (static_cast<size_t>(end - at) < sizeof(fields))
+				return false;
+			std::memcpy(fields, at, sizeof(fields));
+			at += sizeof(fields);
+			if (static_cast<size_t>(end - at) < fields[1] || fields[0] > source.size())
+				return false;
+			result.diagnostics.report(file, fields[0], std::string(at, fields[1]));
+			at += fields[1];
+		}
+
+		// Mapped memory is page aligned and the header keeps the arrays aligned
+		auto tokens = entry.data() + sizeof(CacheHeader);
+		result.tokens.file = file;
+		result.tokens.count = header.tokens;
+		result.tokens.offsets = reinterpret_cast<const uint32_t*>(tokens);
+		result.tokens.lengths = result.tokens.offsets + header.tokens;
+		result.tokens.values = result.tokens.lengths + header.tokens;
+		result.tokens.types = reinterpret_cast<const TokenType*>(result.tokens.values + header.tokens);
+		result.tokens.literals = table.get();
+		result.tokens.symbols = names.get();
+		if (!inBounds(result.tokens, source.size()))
+			return false;
+		result.mapping = std::move(entry);
+		result.literals = std::move(table);
+		result.symbols = std::move(names);
+
+		// Marks the entry as recently used for eviction
+		std::error_code error;
+		fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+		return true;
+	}
+
+	uint64_t TokenCache::store(const std::string& path, uint64_t hash, std::string_view source, Recovery recovery, const TokenStream& tokens, const DiagnosticEngine& diagnostics)
+	{
+		CacheHeader header;
+		std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+		header.format = cacheFormat;
+		header.lexer = lexerVersion;
+		header.recovery = static_cast<uint32_t>(recovery);
+		header.sourceHash = hash;
+		header.sourceSize = source.size();
+		header.tokens = static_cast<uint32_t>(tokens.size());
+		header.diagnostics = static_cast<uint32_t>(diagnostics.size());
+		auto& literals = tokens.literals;
+		header.integers = static_cast<uint32_t>(literals.integers.size());
+		header.floats = static_cast<uint32_t>(literals.floats.size());
+		header.strings = static_cast<uint32_t>(literals.stringCount());
+		header.arena = literals.stringStarts.back();		/* An unterminated string may have left bytes past it */
+		auto& symbols = tokens.symbols;
+		header.symbols = static_cast<uint32_t>(symbols.size());
+		header.symbolSlots = static_cast<uint32_t>(symbols.slots.size());
+		header.symbolBytes = symbols.starts.back();
+		header.reserved = 0;
+
+		std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+		auto append = [&](const auto& array) {
+			bytes.append(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(array[0]));
+		};
+		append(tokens.offsets);
+		append(tokens.lengths);
+		append(tokens.values);
+		append(tokens.types);
+		append(literals.integers);
+		append(literals.floats);
+		append(literals.stringStarts);
+		bytes.append(literals.arena, 0, header.arena);
+		append(symbols.hashes);
+		append(symbols.starts);
+		append(symbols.slots);
+		bytes.append(symbols.arena, 0, header.symbolBytes);
+		for (auto& diagnostic : diagnostics.all())
+		{
+			uint32_t fields[2] = {diagnostic.offset, static_cast<uint32_t>(diagnostic.message.size())};
+			bytes.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+			bytes += diagnostic.message;
+		}
+
+		// Readers only ever see whole entries, rename replaces atomically
+		auto temporary = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())
+			+ "-" + std::to_string(temporaries++);
+		{
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			if (!out)
+			{
+				out.close();
+				std::error_code error;
+				fs::remove(temporary, error);
+				return 0;
+			}
+		}
+
+		std::error_code error;
+		fs::rename(temporary, path, error);
+		if (error)
+		{
+			fs::remove(temporary, error);
+			return 0;
+		}
+		return bytes.size();
+	}
+
+	CachedTokens TokenCache::get(SourceManager& sources, FileId file, Recovery recovery)
+	{
+		auto source = sources.contents(file);
+		auto hash = contentHash(source);
+		// Entries of another lexer, format or recovery mode get names of their own
+		auto key = mixHash(hash ^ (uint64_t(lexerVersion) << 32 | uint64_t(cacheFormat) << 8 | uint64_t(recovery)));
+		auto path = entryPath(key);
+
+		CachedTokens result;
+		if (load(path, hash, source, recovery, file, result))
+		{
+			hits++;
+			result.hit = true;
+			return result;
+		}
+		// A stale or corrupt entry may have left diagnostics behind
+		result.diagnostics.clear();
+		misses++;
+
+		Lexer lexer(sources, file);
+		lexer.reportTo(result.diagnostics);
+		lexer.setRecovery(recovery);
+		result.owned = lexer.tokenizeAll();
+		auto written = store(path, hash, source, recovery, result.owned, result.diagnostics);
+		result.literals = std::make_unique<LiteralTable>(std::move(result.owned.literals));
+		result.symbols = std::make_unique<SymbolTable>(std::move(result.owned.symbols));
+		result.tokens = result.owned;
+		result.tokens.literals = result.literals.get();
+		result.tokens.symbols = result.symbols.get();
+
+		if (written)
+		{
+			stores++;
+			bool over;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				usage += written;
+				over = usage > budget;
+			}
+			if (over)
+				evict();
+		}
+		return result;
+	}
+
+	void TokenCache::evict()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::vector<std::tuple<fs::file_time_type, uint64_t, fs::path>> entries;
+		uint64_t total = 0;
+		std::error_code error;
+		for (fs::directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+		{
+			std::error_code statError;
+			if (it->path().extension() != entryExtension || !it->is_regular_file(statError))
+				continue;
+			auto size = it->file_size(statError);
+			auto time = it->last_write_time(statError);
+			if (statError)
+				continue;
+			entries.emplace_back(time, size, it->path());
+			total += size;
+		}
+
+		// Down to three quarters of the budget, so not every store has to scan the directory
+		if (total > budget)
+		{
+			std::sort(entries.begin(), entries.end());
+			for (auto& [time, size, path] : entries)
+			{
+				if (total <= budget / 4 * 3)
+					break;
+				std::error_code removeError;
+				if (fs::remove(path, removeError))
+				{
+					total -= size;
+					evictions++;
+					bytesEvicted += size;
+				}
+			}
+		}
+		usage = total;
+	}
+
+	TokenCache::Stats TokenCache::stats() const
+	{
+		Stats result;
+		result.hits = hits;
+		result.misses = misses;
+		result.stores = stores;
+		result.evictions = evictions;
+		result.bytesEvicted = bytesEvicted;
+		return result;
+	}
+
+	uint64_t TokenCache::diskUsage() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return usage;
+	}
+
+}}
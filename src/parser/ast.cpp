@@ -0,0 +1,145 @@
+#include "parser/ast.hpp"
+
+namespace threeD { namespace Parser {
+
+	std::ostream& operator<<(std::ostream& out, const NodeKind& kind)
+	{
+		switch (kind)
+		{
+		case NodeKind::Script: return out << "Script";
+		case NodeKind::Function: return out << "Function";
+		case NodeKind::Prototype: return out << "Prototype";
+		case NodeKind::Parameter: return out << "Parameter";
+		case NodeKind::Let: return out << "Let";
+		case NodeKind::Assign: return out << "Assign";
+		case NodeKind::Return: return out << "Return";
+		case NodeKind::Call: return out << "Call";
+		case NodeKind::Binary: return out << "Binary";
+		case NodeKind::Conditional: return out << "Conditional";
+		case NodeKind::Unary: return out << "Unary";
+		case NodeKind::Name: return out << "Name";
+		case NodeKind::Literal: return out << "Literal";
+		}
+		return out << "Unknown";
+	}
+
+	// What the nodes print needs besides the node
+	struct Printer
+	{
+		std::ostream& out;
+		const Ast& ast;
+		const Lexer::TokenStreamView& tokens;
+		std::string_view source;
+
+		std::string_view lexeme(uint32_t token) const { return tokens.lexeme(token, source); }
+
+		void expression(NodeId id)
+		{
+			auto& node = ast[id];
+			switch (node.kind)
+			{
+			case NodeKind::Name:
+			case NodeKind::Literal:
+				out << lexeme(node.token);
+				break;
+			case NodeKind::Unary:
+				out << "(" << lexeme(node.token);
+				expression(node.first);
+				out << ")";
+				break;
+			case NodeKind::Binary:
+				out << "(";
+				expression(node.first);
+				out << " " << lexeme(node.token) << " ";
+				expression(node.second);
+				out << ")";
+				break;
+			case NodeKind::Conditional:
+			{
+				auto results = ast.list(node.second);
+				out << "(";
+				expression(node.first);
+				out << " ? ";
+				expression(results[0]);
+				out << " : ";
+				expression(results[1]);
+				out << ")";
+				break;
+			}
+			case NodeKind::Call:
+			{
+				out << lexeme(node.token) << "(";
+				auto arguments = ast.list(node.first);
+				for (size_t i = 0; i < arguments.size(); i++)
+				{
+					if (i > 0)
+						out << ", ";
+					expression(arguments[i]);
+				}
+				out << ")";
+				break;
+			}
+			default:
+				out << "<" << node.kind << ">";
+				break;
+			}
+		}
+
+		void statement(NodeId id, int indent)
+		{
+			auto& node = ast[id];
+			out << std::string(indent, '\t');
+			switch (node.kind)
+			{
+			case NodeKind::Function:
+			{
+				auto& prototype = ast[node.first];
+				out << "def " << lexeme(node.token) << "(";
+				auto parameters = ast.list(prototype.first);
+				for (size_t i = 0; i < parameters.size(); i++)
+				{
+					auto& parameter = ast[parameters[i]];
+					out << (i > 0 ? ", " : "") << lexeme(parameter.token) << ": " << lexeme(parameter.first);
+				}
+				out << ")";
+				if (prototype.second != InvalidNodeId)
+					out << " -> " << lexeme(prototype.second);
+				out << ":\n";
+				for (auto item : ast.list(node.second))
+					statement(item, indent + 1);
+				return;
+			}
+			case NodeKind::Let:
+				out << "let " << lexeme(node.token) << " := ";
+				expression(node.first);
+				break;
+			case NodeKind::Assign:
+				out << lexeme(node.token) << " " << lexeme(node.token + 1) << " ";
+				expression(node.first);
+				break;
+			case NodeKind::Return:
+				out << "ret";
+				if (node.first != InvalidNodeId)
+				{
+					out << " ";
+					expression(node.first);
+				}
+				break;
+			default:
+				expression(id);
+				break;
+			}
+			out << "\n";
+		}
+	};
+
+	void print(std::ostream& out, const Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source)
+	{
+		if (ast.root == InvalidNodeId)
+			return;
+		Printer printer{out, ast, tokens, source};
+		for (auto item : ast.list(ast[ast.root].first))
+			printer.statement(item, 0);
+	}
+
+}}
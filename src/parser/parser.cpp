@@ -0,0 +1,397 @@
+#include "parser/parser.hpp"
+
+#include <cstring>
+
+namespace threeD { namespace Parser {
+
+	// How tightly a binary operator binds, 0 if type is not one
+	static int precedence(TokenType type)
+	{
+		switch (type)
+		{
+		case TokenType::OR: return 1;
+		case TokenType::AND: return 2;
+		case TokenType::EQ: case TokenType::NEQ: return 3;
+		case TokenType::LT: case TokenType::LEQ: case TokenType::GT: case TokenType::GEQ: return 4;
+		case TokenType::ADD: case TokenType::SUB: return 5;
+		case TokenType::MUL: case TokenType::DIV: case TokenType::MOD: return 6;
+		default: return 0;
+		}
+	}
+
+	static bool isAssignment(TokenType type)
+	{
+		switch (type)
+		{
+		case TokenType::ASSIGN: case TokenType::ADD_ASSIGN: case TokenType::SUB_ASSIGN:
+		case TokenType::MUL_ASSIGN: case TokenType::DIV_ASSIGN:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool isLiteral(TokenType type)
+	{
+		switch (type)
+		{
+		case TokenType::BOOL_LITERAL: case TokenType::INT_LITERAL: case TokenType::FLOAT_LITERAL:
+		case TokenType::CHAR_LITERAL: case TokenType::STR_LITERAL:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static bool startsExpression(TokenType type)
+	{
+		return isLiteral(type) || type == TokenType::IDENTIFIER || type == TokenType::LPAREN
+			|| type == TokenType::NOT || type == TokenType::SUB;
+	}
+
+	Parser::Parser(const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics)
+		: tokens(tokens), source(source), diagnostics(diagnostics)
+	{
+		// Punctuation makes no nodes, so a node per token is enough and nodes never grow
+		ast.nodes.reserve(tokens.size() + 1);
+		ast.lists.reserve(tokens.size() / 4 + 16);
+		scratch.reserve(64);
+	}
+
+	Ast Parser::parse()
+	{
+		auto start = scratch.size();
+		while (peek() != TokenType::EOF_)
+		{
+			auto item = peek() == TokenType::DEF ? function() : statement();
+			if (item != InvalidNodeId)
+				scratch.push_back(item);
+			else
+				synchronize();
+		}
+		ast.root = add(NodeKind::Script, TokenType::EOF_, InvalidNodeId, endList(start));
+		return std::move(ast);
+	}
+
+	bool Parser::accept(TokenType type)
+	{
+		if (peek() != type)
+			return false;
+		at++;
+		return true;
+	}
+
+	bool Parser::expect(TokenType type, const char* what)
+	{
+		if (accept(type))
+			return true;
+		expected(what);
+		return false;
+	}
+
+	// Reports message at the next token
+	void Parser::error(std::string message)
+	{
+		// The lexer reported this one already
+		if (peek() == TokenType::ERROR)
+			return;
+		auto offset = at < tokens.size() ? tokens.offsets[at] : static_cast<uint32_t>(source.size());
+		diagnostics.report(tokens.file, offset, std::move(message));
+	}
+
+	// Reports that what was expected instead of the next token
+	void Parser::expected(const char* what)
+	{
+		if (at < tokens.size())
+			error(std::string("Expected ") + what + " but found '" + std::string(tokens.lexeme(at, source)) + "'");
+		else
+			error(std::string("Expected ") + what + " but found end of file");
+	}
+
+	// Skips to the next token that can only start a statement or a function
+	void Parser::synchronize()
+	{
+		while (peek() != TokenType::LET && peek() != TokenType::RET && peek() != TokenType::DEF && peek() != TokenType::EOF_)
+			at++;
+	}
+
+	NodeId Parser::add(NodeKind kind, TokenType op, uint32_t token, uint32_t first, uint32_t second)
+	{
+		ast.nodes.push_back({kind, op, token, first, second});
+		return static_cast<NodeId>(ast.nodes.size() - 1);
+	}
+
+	// Moves the items pushed to scratch since scratchStart into a list
+	ListId Parser::endList(size_t scratchStart)
+	{
+		auto id = static_cast<ListId>(ast.lists.size());
+		ast.lists.push_back(static_cast<NodeId>(scratch.size() - scratchStart));
+		ast.lists.insert(ast.lists.end(), scratch.begin() + scratchStart, scratch.end());
+		scratch.resize(scratchStart);
+		return id;
+	}
+
+	NodeId Parser::function()
+	{
+		auto proto = prototype();
+		if (proto == InvalidNodeId)
+			return InvalidNodeId;
+
+		auto start = scratch.size();
+		while (peek() != TokenType::DEF && peek() != TokenType::EOF_)
+		{
+			auto item = statement();
+			if (item != InvalidNodeId)
+				scratch.push_back(item);
+			else
+				synchronize();
+		}
+		return add(NodeKind::Function, TokenType::EOF_, ast[proto].token + 1, proto, endList(start));
+	}
+
+	NodeId Parser::prototype()
+	{
+		auto def = at++;
+		if (!expect(TokenType::IDENTIFIER, "a function name") || !expect(TokenType::LPAREN, "'(' after the function name"))
+			return InvalidNodeId;
+
+		auto start = scratch.size();
+		if (!accept(TokenType::RPAREN))
+		{
+			do
+			{
+				auto name = at;
+				if (!expect(TokenType::IDENTIFIER, "a parameter name") || !expect(TokenType::COLON, "':' after the parameter name"))
+				{
+					scratch.resize(start);
+					return InvalidNodeId;
+				}
+				auto type = at;
+				if (!expect(TokenType::INT, "a type"))
+				{
+					scratch.resize(start);
+					return InvalidNodeId;
+				}
+				scratch.push_back(add(NodeKind::Parameter, TokenType::EOF_, name, type));
+			} while (accept(TokenType::COMMA));
+
+			if (!expect(TokenType::RPAREN, "',' or ')' after the parameter"))
+			{
+				scratch.resize(start);
+				return InvalidNodeId;
+			}
+		}
+		auto parameters = endList(start);
+
+		uint32_t returns = InvalidNodeId;
+		if (accept(TokenType::ARROW))
+		{
+			returns = at;
+			if (!expect(TokenType::INT, "a return type"))
+				return InvalidNodeId;
+		}
+		if (!expect(TokenType::COLON, "':' before the function body"))
+			return InvalidNodeId;
+		return add(NodeKind::Prototype, TokenType::EOF_, def, parameters, returns);
+	}
+
+	NodeId Parser::statement()
+	{
+		auto first = at;
+		switch (peek())
+		{
+		case TokenType::LET:
+		{
+			at++;
+			auto name = at;
+			if (!expect(TokenType::IDENTIFIER, "a name after let") || !expect(TokenType::ASSIGN, "':='"))
+				return InvalidNodeId;
+			auto value = expression();
+			if (value == InvalidNodeId)
+				return InvalidNodeId;
+			return add(NodeKind::Let, TokenType::EOF_, name, value);
+		}
+		case TokenType::RET:
+		{
+			at++;
+			// Without separators a bare ret is only told apart by a line break
+			uint32_t value = InvalidNodeId;
+			auto retEnd = tokens.offsets[first] + tokens.lengths[first];
+			if (startsExpression(peek()) && !std::memchr(source.data() + retEnd, '\n', tokens.offsets[at] - retEnd))
+			{
+				value = expression();
+				if (value == InvalidNodeId)
+					return InvalidNodeId;
+			}
+			return add(NodeKind::Return, TokenType::EOF_, first, value);
+		}
+		case TokenType::IDENTIFIER:
+		{
+			if (peek(1) == TokenType::LPAREN)
+				return call();
+			at++;
+			auto op = peek();
+			if (!isAssignment(op))
+			{
+				expected("'(' or an assignment after the name");
+				return InvalidNodeId;
+			}
+			at++;
+			auto value = expression();
+			if (value == InvalidNodeId)
+				return InvalidNodeId;
+			return add(NodeKind::Assign, op, first, value);
+		}
+		default:
+			expected("a statement");
+			if (peek() != TokenType::EOF_)
+				at++;
+			return InvalidNodeId;
+		}
+	}
+
+	// The conditional binds looser than any binary operator and groups to the right
+	NodeId Parser::expression()
+	{
+		auto condition = binary();
+		if (condition == InvalidNodeId || peek() != TokenType::QUESTION)
+			return condition;
+		if (depth == maxDepth)
+		{
+			error("Expression nested deeper than " + std::to_string(maxDepth) + " levels");
+			return InvalidNodeId;
+		}
+
+		depth++;
+		auto question = at++;
+		auto start = scratch.size();
+		auto then = expression();
+		if (then != InvalidNodeId)
+		{
+			scratch.push_back(then);
+			if (expect(TokenType::COLON, "':' in the conditional"))
+			{
+				auto otherwise = expression();
+				if (otherwise != InvalidNodeId)
+					scratch.push_back(otherwise);
+			}
+		}
+		depth--;
+
+		if (scratch.size() - start != 2)
+		{
+			scratch.resize(start);
+			return InvalidNodeId;
+		}
+		return add(NodeKind::Conditional, TokenType::EOF_, question, condition, endList(start));
+	}
+
+	// Precedence climbing, every operator binds left to right
+	NodeId Parser::binary(int minimum)
+	{
+		auto left = unary();
+		while (left != InvalidNodeId)
+		{
+			auto op = peek();
+			auto binds = precedence(op);
+			if (binds < minimum)
+				break;
+			auto token = at++;
+			auto right = binary(binds + 1);
+			if (right == InvalidNodeId)
+				return InvalidNodeId;
+			left = add(NodeKind::Binary, op, token, left, right);
+		}
+		return left;
+	}
+
+	NodeId Parser::unary()
+	{
+		if (depth == maxDepth)
+		{
+			error("Expression nested deeper than " + std::to_string(maxDepth) + " levels");
+			return InvalidNodeId;
+		}
+
+		depth++;
+		NodeId node;
+		auto op = peek();
+		if (op == TokenType::NOT || op == TokenType::SUB)
+		{
+			auto token = at++;
+			auto operand = unary();
+			node = operand == InvalidNodeId ? InvalidNodeId : add(NodeKind::Unary, op, token, operand);
+		}
+		else
+			node = primary();
+		depth--;
+		return node;
+	}
+
+	NodeId Parser::primary()
+	{
+		auto type = peek();
+		if (isLiteral(type))
+		{
+			auto token = at++;
+			return add(NodeKind::Literal, type, token);
+		}
+
+		switch (type)
+		{
+		case TokenType::IDENTIFIER:
+		{
+			if (peek(1) == TokenType::LPAREN)
+				return call();
+			auto token = at++;
+			return add(NodeKind::Name, TokenType::EOF_, token);
+		}
+		case TokenType::LPAREN:
+		{
+			at++;
+			auto inner = expression();
+			if (inner == InvalidNodeId || !expect(TokenType::RPAREN, "')'"))
+				return InvalidNodeId;
+			return inner;
+		}
+		default:
+			expected("an expression");
+			return InvalidNodeId;
+		}
+	}
+
+	// At a name followed by '('
+	NodeId Parser::call()
+	{
+		auto callee = at;
+		at += 2;
+
+		auto start = scratch.size();
+		if (!accept(TokenType::RPAREN))
+		{
+			do
+			{
+				auto argument = expression();
+				if (argument == InvalidNodeId)
+				{
+					scratch.resize(start);
+					return InvalidNodeId;
+				}
+				scratch.push_back(argument);
+			} while (accept(TokenType::COMMA));
+
+			if (!expect(TokenType::RPAREN, "',' or ')' after the argument"))
+			{
+				scratch.resize(start);
+				return InvalidNodeId;
+			}
+		}
+		return add(NodeKind::Call, TokenType::EOF_, callee, endList(start));
+	}
+
+	Ast parse(const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics)
+	{
+		return Parser(tokens, source, diagnostics).parse();
+	}
+
+}}
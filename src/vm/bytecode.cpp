@@ -0,0 +1,83 @@
+#include "vm/bytecode.hpp"
+
+namespace threeD { namespace Vm {
+
+	const char* opName(Op op)
+	{
+		switch (op)
+		{
+	#define THREED_VM_NAME(name) case Op::name: return #name;
+			THREED_VM_OPS(THREED_VM_NAME)
+	#undef THREED_VM_NAME
+		}
+		return "UNKNOWN";
+	}
+
+	FunctionId Program::find(std::string_view name) const
+	{
+		for (FunctionId id = 0; id < functions.size(); id++)
+		{
+			if (functions[id].name == name)
+				return id;
+		}
+		return InvalidFunctionId;
+	}
+
+	void disassemble(std::ostream& out, const Program& program)
+	{
+		for (auto& function : program.functions)
+		{
+			auto end = program.code.size();
+			for (auto& other : program.functions)
+			{
+				if (other.entry > function.entry && other.entry < end)
+					end = other.entry;
+			}
+
+			out << function.name << ": " << int(function.parameters) << " parameters, " << function.registers << " registers\n";
+			for (auto pc = function.entry; pc < end; pc++)
+			{
+				auto& instruction = program.code[pc];
+				out << "\t" << pc << "\t" << opName(instruction.op) << "\t";
+				switch (instruction.op)
+				{
+				case Op::LOADK:
+				{
+					auto& constant = program.constants[instruction.bx()];
+					out << "r" << int(instruction.a) << " k" << instruction.bx() << "\t; " << constant.i << " or " << constant.f;
+					break;
+				}
+				case Op::LOADI:
+					out << "r" << int(instruction.a) << " " << instruction.sbx();
+					break;
+				case Op::ADDI:
+					out << "r" << int(instruction.a) << " r" << int(instruction.b) << " " << int(static_cast<int8_t>(instruction.c));
+					break;
+				case Op::JMP:
+					out << "-> " << pc + 1 + instruction.sbx();
+					break;
+				case Op::JMPF:
+				case Op::JMPT:
+					out << "r" << int(instruction.a) << " -> " << pc + 1 + instruction.sbx();
+					break;
+				case Op::CALL:
+				case Op::TAILCALL:
+					out << "r" << int(instruction.a) << " " << program.functions[instruction.bx()].name;
+					break;
+				case Op::RET:
+					out << "r" << int(instruction.a);
+					break;
+				case Op::MOVE: case Op::NOT: case Op::NEG: case Op::FNEG:
+				case Op::ITOF: case Op::FTOI: case Op::BOOL: case Op::FBOOL:
+					out << "r" << int(instruction.a) << " r" << int(instruction.b);
+					break;
+				default:
+					out << "r" << int(instruction.a) << " r" << int(instruction.b) << " r" << int(instruction.c);
+					break;
+				}
+				out << "\n";
+			}
+		}
+	}
+
+}}
@@ -0,0 +1,590 @@
+#include "vm/compiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace threeD { namespace Vm {
+
+	using Parser::NodeKind;
+
+	static bool isComparison(TokenType op)
+	{
+		return op == TokenType::EQ || op == TokenType::NEQ || op == TokenType::LT
+			|| op == TokenType::LEQ || op == TokenType::GT || op == TokenType::GEQ;
+	}
+
+	// The operator a compound assignment applies
+	static TokenType assigned(TokenType op)
+	{
+		switch (op)
+		{
+		case TokenType::ADD_ASSIGN: return TokenType::ADD;
+		case TokenType::SUB_ASSIGN: return TokenType::SUB;
+		case TokenType::MUL_ASSIGN: return TokenType::MUL;
+		case TokenType::DIV_ASSIGN: return TokenType::DIV;
+		default: return TokenType::EOF_;
+		}
+	}
+
+	// && || and the conditional write their target before they are done reading
+	static bool writesTargetLast(const Parser::Node& node)
+	{
+		if (node.kind == NodeKind::Conditional)
+			return false;
+		return node.kind != NodeKind::Binary || (node.op != TokenType::AND && node.op != TokenType::OR);
+	}
+
+	Compiler::Compiler(const Parser::Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics)
+		: ast(ast), tokens(tokens), source(source), diagnostics(diagnostics)
+	{
+	}
+
+	Program Compiler::compile()
+	{
+		if (ast.root == Parser::InvalidNodeId)
+			return std::move(program);
+
+		// Every function is known before any body is compiled, calls may come before definitions
+		std::vector<std::pair<NodeId, FunctionId>> bodies;
+		for (auto item : ast.list(ast[ast.root].first))
+		{
+			auto& node = ast[item];
+			failed = false;
+			if (node.kind != NodeKind::Function)
+			{
+				error(node.token, "Statements outside a function are not compiled");
+				continue;
+			}
+
+			auto name = tokens.lexeme(node.token, source);
+			auto parameters = ast.list(ast[node.first].first).size();
+			if (functions.count(tokens.values[node.token]))
+				error(node.token, "Function '" + std::string(name) + "' is defined twice");
+			else if (program.functions.size() > UINT16_MAX)
+				error(node.token, "More than " + std::to_string(UINT16_MAX + 1) + " functions");
+			else if (parameters > UINT8_MAX)
+				error(node.token, "Function '" + std::string(name) + "' has more than " + std::to_string(UINT8_MAX) + " parameters");
+			else
+			{
+				auto id = static_cast<FunctionId>(program.functions.size());
+				functions[tokens.values[node.token]] = id;
+				program.functions.push_back({std::string(name), 0, static_cast<uint8_t>(parameters), 0});
+				bodies.emplace_back(item, id);
+			}
+		}
+
+		for (auto [item, id] : bodies)
+			function(item, id);
+		return std::move(program);
+	}
+
+	void Compiler::function(NodeId id, FunctionId function)
+	{
+		auto& node = ast[id];
+		program.functions[function].entry = static_cast<uint32_t>(program.code.size());
+		locals.clear();
+		top = 0;
+		registers = 0;
+
+		failed = false;
+		for (auto parameter : ast.list(ast[node.first].first))
+		{
+			auto& declared = ast[parameter];
+			locals.push_back({tokens.values[declared.token], allocate(declared.token), Type::Int});
+		}
+
+		auto body = ast.list(node.second);
+		for (auto item : body)
+		{
+			failed = false;
+			statement(item);
+		}
+
+		// Falling off the end returns 0
+		if (body.empty() || ast[body.back()].kind != NodeKind::Return)
+		{
+			failed = false;
+			auto reg = allocate(node.token);
+			emit(Instruction::wide(Op::LOADI, reg, 0));
+			emit(Instruction::make(Op::RET, reg));
+		}
+		program.functions[function].registers = static_cast<uint16_t>(registers);
+	}
+
+	void Compiler::statement(NodeId id)
+	{
+		auto& node = ast[id];
+		auto mark = top;
+		switch (node.kind)
+		{
+		case NodeKind::Let:
+		{
+			// The value is compiled before the name is declared, let x := x + 1 reads the old x
+			auto reg = allocate(node.token);
+			auto type = expression(node.first, reg);
+			locals.push_back({tokens.values[node.token], reg, type});
+			mark = top;
+			break;
+		}
+		case NodeKind::Assign:
+		{
+			auto variable = local(node.token);
+			if (!variable)
+				break;
+
+			if (node.op == TokenType::ASSIGN)
+			{
+				Type type;
+				if (writesTargetLast(ast[node.first]))
+					type = expression(node.first, variable->reg);
+				else
+				{
+					auto value = allocate(node.token);
+					type = expression(node.first, value);
+					emit(Instruction::make(Op::MOVE, variable->reg, value));
+				}
+				convert(variable->reg, type, variable->type);
+			}
+			else
+			{
+				Type valueType;
+				auto value = operand(node.first, valueType);
+				auto type = arithmetic(assigned(node.op), node.token + 1, variable->reg, variable->reg, variable->type, value, valueType);
+				convert(variable->reg, type, variable->type);
+			}
+			break;
+		}
+		case NodeKind::Return:
+			if (node.first == Parser::InvalidNodeId)
+			{
+				auto reg = allocate(node.token);
+				emit(Instruction::wide(Op::LOADI, reg, 0));
+				emit(Instruction::make(Op::RET, reg));
+			}
+			else
+				returnValue(node.first);
+			break;
+		case NodeKind::Call:
+			call(node, static_cast<uint8_t>(std::min(top, 255u)), false);
+			break;
+		default:
+			error(node.token, "Expected a statement");
+			break;
+		}
+		top = mark;
+	}
+
+	// Returns the value of id, as a tail call if it is one or ends in one
+	void Compiler::returnValue(NodeId id)
+	{
+		auto& node = ast[id];
+		auto mark = top;
+		if (node.kind == NodeKind::Conditional)
+		{
+			auto results = ast.list(node.second);
+			auto otherwise = emit(Instruction::wide(Op::JMPF, condition(node.first), 0));
+			top = mark;
+			returnValue(results[0]);
+			patch(otherwise, node.token);
+			returnValue(results[1]);
+		}
+		else if (node.kind == NodeKind::Call)
+			call(node, static_cast<uint8_t>(std::min(top, 255u)), true);
+		else
+		{
+			Type type;
+			auto reg = operand(id, type);
+			if (type == Type::Float)
+			{
+				auto converted = allocate(node.token);
+				emit(Instruction::make(Op::FTOI, converted, reg));
+				reg = converted;
+			}
+			emit(Instruction::make(Op::RET, reg));
+		}
+		top = mark;
+	}
+
+	// Compiles id into target, temporaries above target are free again afterwards
+	Compiler::Type Compiler::expression(NodeId id, uint8_t target)
+	{
+		auto& node = ast[id];
+		auto mark = top;
+		auto type = Type::Int;
+		switch (node.kind)
+		{
+		case NodeKind::Literal:
+		{
+			auto value = tokens.values[node.token];
+			switch (node.op)
+			{
+			case TokenType::FLOAT_LITERAL:
+				emit(Instruction::wide(Op::LOADK, target, constant({.f = tokens.literals->floating(value)}, true)));
+				type = Type::Float;
+				break;
+			case TokenType::INT_LITERAL:
+			case TokenType::CHAR_LITERAL:
+			case TokenType::BOOL_LITERAL:
+			{
+				int64_t integer = node.op == TokenType::INT_LITERAL ? static_cast<int64_t>(tokens.literals->integer(value)) : value;
+				if (integer >= INT16_MIN && integer <= INT16_MAX)
+					emit(Instruction::wide(Op::LOADI, target, static_cast<uint16_t>(integer)));
+				else
+					emit(Instruction::wide(Op::LOADK, target, constant({.i = integer}, false)));
+				type = node.op == TokenType::BOOL_LITERAL ? Type::Bool : Type::Int;
+				break;
+			}
+			default:
+				error(node.token, "Strings are not supported by the compiler");
+				break;
+			}
+			break;
+		}
+		case NodeKind::Name:
+			if (auto variable = local(node.token))
+			{
+				if (variable->reg != target)
+					emit(Instruction::make(Op::MOVE, target, variable->reg));
+				type = variable->type;
+			}
+			break;
+		case NodeKind::Call:
+			// A temporary nothing lives above can be the callee's frame, which saves the move
+			if (target + 1u == top && target >= locals.size())
+				call(node, target, false);
+			else
+			{
+				auto base = allocate(node.token);
+				call(node, base, false);
+				emit(Instruction::make(Op::MOVE, target, base));
+			}
+			break;
+		case NodeKind::Unary:
+		{
+			auto reg = operand(node.first, type);
+			if (node.op == TokenType::NOT)
+			{
+				if (type == Type::Float)
+				{
+					auto truth = allocate(node.token);
+					emit(Instruction::make(Op::FBOOL, truth, reg));
+					reg = truth;
+				}
+				emit(Instruction::make(Op::NOT, target, reg));
+				type = Type::Bool;
+			}
+			else
+			{
+				emit(Instruction::make(type == Type::Float ? Op::FNEG : Op::NEG, target, reg));
+				type = type == Type::Float ? Type::Float : Type::Int;
+			}
+			break;
+		}
+		case NodeKind::Binary:
+		{
+			if (node.op == TokenType::AND || node.op == TokenType::OR)
+			{
+				type = logical(node, target);
+				break;
+			}
+
+			Type leftType;
+			auto left = operand(node.first, leftType);
+
+			// x + 1 and x - 1 take the constant from the instruction
+			auto& right = ast[node.second];
+			if ((node.op == TokenType::ADD || node.op == TokenType::SUB) && leftType != Type::Float
+				&& right.kind == NodeKind::Literal && right.op == TokenType::INT_LITERAL)
+			{
+				// Negated unsigned, a literal of 2^63 would overflow as int64_t
+				auto bits = tokens.literals->integer(tokens.values[right.token]);
+				auto value = static_cast<int64_t>(node.op == TokenType::SUB ? 0 - bits : bits);
+				if (value >= INT8_MIN && value <= INT8_MAX)
+				{
+					emit(Instruction::make(Op::ADDI, target, left, static_cast<uint8_t>(value)));
+					type = Type::Int;
+					break;
+				}
+			}
+
+			Type rightType;
+			auto rightReg = operand(node.second, rightType);
+			type = arithmetic(node.op, node.token, target, left, leftType, rightReg, rightType);
+			break;
+		}
+		case NodeKind::Conditional:
+			type = conditional(id, target);
+			break;
+		default:
+			error(node.token, "Expected an expression");
+			break;
+		}
+		top = mark;
+		return type;
+	}
+
+	// A register holding the value of id: a variable's own, or a new temporary
+	uint8_t Compiler::operand(NodeId id, Type& type)
+	{
+		auto& node = ast[id];
+		if (node.kind == NodeKind::Name)
+		{
+			if (auto variable = local(node.token))
+			{
+				type = variable->type;
+				return variable->reg;
+			}
+			type = Type::Int;
+			return 0;
+		}
+		auto reg = allocate(node.token);
+		type = expression(id, reg);
+		return reg;
+	}
+
+	// A register that is 0 if id is false
+	uint8_t Compiler::condition(NodeId id)
+	{
+		Type type;
+		auto reg = operand(id, type);
+		if (type != Type::Float)
+			return reg;
+		auto truth = allocate(ast[id].token);
+		emit(Instruction::make(Op::FBOOL, truth, reg));
+		return truth;
+	}
+
+	// The type expression() will give id, without compiling it
+	Compiler::Type Compiler::typeOf(NodeId id) const
+	{
+		auto& node = ast[id];
+		switch (node.kind)
+		{
+		case NodeKind::Literal:
+			return node.op == TokenType::FLOAT_LITERAL ? Type::Float : node.op == TokenType::BOOL_LITERAL ? Type::Bool : Type::Int;
+		case NodeKind::Name:
+		{
+			auto variable = find(node.token);
+			return variable ? variable->type : Type::Int;
+		}
+		case NodeKind::Unary:
+			if (node.op == TokenType::NOT)
+				return Type::Bool;
+			return typeOf(node.first) == Type::Float ? Type::Float : Type::Int;
+		case NodeKind::Binary:
+			if (node.op == TokenType::AND || node.op == TokenType::OR || isComparison(node.op))
+				return Type::Bool;
+			return typeOf(node.first) == Type::Float || typeOf(node.second) == Type::Float ? Type::Float : Type::Int;
+		case NodeKind::Conditional:
+		{
+			auto results = ast.list(node.second);
+			auto then = typeOf(results[0]), otherwise = typeOf(results[1]);
+			if (then == otherwise)
+				return then;
+			return then == Type::Float || otherwise == Type::Float ? Type::Float : Type::Int;
+		}
+		default:
+			return Type::Int;
+		}
+	}
+
+	// target = left op right, an int operand is made a float if the other one is
+	Compiler::Type Compiler::arithmetic(TokenType op, uint32_t token, uint8_t target, uint8_t left, Type leftType, uint8_t right, Type rightType)
+	{
+		bool isFloat = leftType == Type::Float || rightType == Type::Float;
+		if (isFloat && leftType != Type::Float)
+		{
+			auto converted = allocate(token);
+			emit(Instruction::make(Op::ITOF, converted, left));
+			left = converted;
+		}
+		if (isFloat && rightType != Type::Float)
+		{
+			auto converted = allocate(token);
+			emit(Instruction::make(Op::ITOF, converted, right));
+			right = converted;
+		}
+
+		Op code;
+		switch (op)
+		{
+		case TokenType::ADD: code = isFloat ? Op::FADD : Op::ADD; break;
+		case TokenType::SUB: code = isFloat ? Op::FSUB : Op::SUB; break;
+		case TokenType::MUL: code = isFloat ? Op::FMUL : Op::MUL; break;
+		case TokenType::DIV: code = isFloat ? Op::FDIV : Op::DIV; break;
+		case TokenType::MOD: code = isFloat ? Op::FMOD : Op::MOD; break;
+		case TokenType::EQ: code = isFloat ? Op::FEQ : Op::EQ; break;
+		case TokenType::NEQ: code = isFloat ? Op::FNEQ : Op::NEQ; break;
+		case TokenType::LT: code = isFloat ? Op::FLT : Op::LT; break;
+		case TokenType::LEQ: code = isFloat ? Op::FLEQ : Op::LEQ; break;
+		case TokenType::GT: code = isFloat ? Op::FGT : Op::GT; break;
+		case TokenType::GEQ: code = isFloat ? Op::FGEQ : Op::GEQ; break;
+		default:
+			error(token, "Operator is not supported by the compiler");
+			return Type::Int;
+		}
+		emit(Instruction::make(code, target, left, right));
+		if (isComparison(op))
+			return Type::Bool;
+		return isFloat ? Type::Float : Type::Int;
+	}
+
+	// Short-circuits: the right side only runs if the left one does not decide
+	Compiler::Type Compiler::logical(const Parser::Node& node, uint8_t target)
+	{
+		convert(target, expression(node.first, target), Type::Bool);
+		auto skip = emit(Instruction::wide(node.op == TokenType::AND ? Op::JMPF : Op::JMPT, target, 0));
+		convert(target, expression(node.second, target), Type::Bool);
+		patch(skip, node.token);
+		return Type::Bool;
+	}
+
+	Compiler::Type Compiler::conditional(NodeId id, uint8_t target)
+	{
+		auto& node = ast[id];
+		auto type = typeOf(id);
+		auto results = ast.list(node.second);
+
+		auto mark = top;
+		auto otherwise = emit(Instruction::wide(Op::JMPF, condition(node.first), 0));
+		top = mark;
+		convert(target, expression(results[0], target), type);
+		auto end = emit(Instruction::wide(Op::JMP, 0, 0));
+		patch(otherwise, node.token);
+		convert(target, expression(results[1], target), type);
+		patch(end, node.token);
+		return type;
+	}
+
+	// Arguments go to base and up, then the result to base. Nothing may live above base.
+	void Compiler::call(const Parser::Node& node, uint8_t base, bool tail)
+	{
+		auto function = callee(node.token);
+		if (function == InvalidFunctionId)
+			return;
+
+		auto arguments = ast.list(node.first);
+		auto& called = program.functions[function];
+		if (arguments.size() != called.parameters)
+		{
+			error(node.token, "'" + called.name + "' takes " + std::to_string(called.parameters) + " arguments but "
+				+ std::to_string(arguments.size()) + " were given");
+			return;
+		}
+
+		while (top <= base)
+			allocate(node.token);
+		for (size_t i = 0; i < arguments.size(); i++)
+		{
+			auto reg = static_cast<uint8_t>(std::min<size_t>(base + i, 255));
+			while (top <= reg)
+				allocate(node.token);
+			convert(reg, expression(arguments[i], reg), Type::Int);
+		}
+		emit(Instruction::wide(tail ? Op::TAILCALL : Op::CALL, base, static_cast<uint16_t>(function)));
+	}
+
+	// Converts the value in reg in place
+	void Compiler::convert(uint8_t reg, Type from, Type to)
+	{
+		if (from == to || (from == Type::Bool && to == Type::Int))
+			return;
+		if (to == Type::Float)
+			emit(Instruction::make(Op::ITOF, reg, reg));
+		else if (from == Type::Float)
+			emit(Instruction::make(to == Type::Bool ? Op::FBOOL : Op::FTOI, reg, reg));
+		else
+			emit(Instruction::make(Op::BOOL, reg, reg));
+	}
+
+	uint8_t Compiler::allocate(uint32_t token)
+	{
+		if (top > UINT8_MAX)
+		{
+			error(token, "Function needs more than " + std::to_string(UINT8_MAX + 1) + " registers");
+			return UINT8_MAX;
+		}
+		auto reg = static_cast<uint8_t>(top++);
+		registers = std::max(registers, top);
+		return reg;
+	}
+
+	// The innermost variable token names, nullptr if there is none
+	const Compiler::Local* Compiler::find(uint32_t token) const
+	{
+		auto symbol = tokens.values[token];
+		for (auto variable = locals.rbegin(); variable != locals.rend(); variable++)
+		{
+			if (variable->symbol == symbol)
+				return &*variable;
+		}
+		return nullptr;
+	}
+
+	// find() that reports a variable it does not find
+	const Compiler::Local* Compiler::local(uint32_t token)
+	{
+		auto variable = find(token);
+		if (!variable)
+			error(token, "Unknown variable '" + std::string(tokens.lexeme(token, source)) + "'");
+		return variable;
+	}
+
+	FunctionId Compiler::callee(uint32_t token)
+	{
+		auto found = functions.find(tokens.values[token]);
+		if (found != functions.end())
+			return found->second;
+		error(token, "Unknown function '" + std::string(tokens.lexeme(token, source)) + "'");
+		return InvalidFunctionId;
+	}
+
+	uint16_t Compiler::constant(Value value, bool isFloat)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		auto& pool = isFloat ? floats : integers;
+		auto found = pool.find(bits);
+		if (found != pool.end())
+			return found->second;
+
+		if (program.constants.size() > UINT16_MAX)
+		{
+			error(0, "More than " + std::to_string(UINT16_MAX + 1) + " constants");
+			return 0;
+		}
+		auto index = static_cast<uint16_t>(program.constants.size());
+		program.constants.push_back(value);
+		pool.emplace(bits, index);
+		return index;
+	}
+
+	// Points the jump at jump to the next instruction emitted
+	void Compiler::patch(size_t jump, uint32_t token)
+	{
+		auto offset = static_cast<ptrdiff_t>(program.code.size()) - static_cast<ptrdiff_t>(jump + 1);
+		if (offset > INT16_MAX)
+		{
+			error(token, "Function is too large to jump across");
+			return;
+		}
+		auto& instruction = program.code[jump];
+		instruction = Instruction::wide(instruction.op, instruction.a, static_cast<uint16_t>(offset));
+	}
+
+	void Compiler::error(uint32_t token, std::string message)
+	{
+		if (failed)
+			return;
+		failed = true;
+		auto offset = token < tokens.size() ? tokens.offsets[token] : static_cast<uint32_t>(source.size());
+		diagnostics.report(tokens.file, offset, std::move(message));
+	}
+
+	Program compile(const Parser::Ast& ast, const Lexer::TokenStreamView& tokens, std::string_view source, Lexer::DiagnosticEngine& diagnostics)
+	{
+		return Compiler(ast, tokens, source, diagnostics).compile();
+	}
+
+}}
@@ -0,0 +1,278 @@
+#include "vm/machine.hpp"
+
+#include <cmath>
+#include <limits>
+
+// Computed goto is a GNU extension, other compilers always use the switch
+#if !defined(THREED_VM_SWITCH_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+	#define THREED_VM_COMPUTED_GOTO 1
+#else
+	#define THREED_VM_COMPUTED_GOTO 0
+#endif
+
+namespace threeD { namespace Vm {
+
+	// Signed overflow is undefined, integers wrap through their unsigned form
+	static inline int64_t wrap(uint64_t value)
+	{
+		return static_cast<int64_t>(value);
+	}
+
+	static inline int64_t truncate(double value)
+	{
+		if (std::isnan(value))
+			return 0;
+		if (value <= static_cast<double>(std::numeric_limits<int64_t>::min()))
+			return std::numeric_limits<int64_t>::min();
+		if (value >= static_cast<double>(std::numeric_limits<int64_t>::max()))
+			return std::numeric_limits<int64_t>::max();
+		return static_cast<int64_t>(value);
+	}
+
+	Machine::Machine(const Program& program, size_t stackRegisters)
+		: program(program), stack(stackRegisters)
+	{
+		frames.reserve(maxFrames);
+	}
+
+	const char* Machine::dispatch()
+	{
+		return THREED_VM_COMPUTED_GOTO ? "computed goto" : "switch";
+	}
+
+	bool Machine::fail(std::string error)
+	{
+		message = std::move(error);
+		return false;
+	}
+
+	bool Machine::call(FunctionId function, std::span<const int64_t> arguments, int64_t& result)
+	{
+		message.clear();
+		frames.clear();
+		if (function >= program.functions.size())
+			return fail("No function " + std::to_string(function));
+		auto& called = program.functions[function];
+		if (arguments.size() != called.parameters)
+			return fail("'" + called.name + "' takes " + std::to_string(called.parameters) + " arguments but "
+				+ std::to_string(arguments.size()) + " were given");
+		if (called.registers > stack.size())
+			return fail("Stack overflow");
+		for (size_t i = 0; i < arguments.size(); i++)
+			stack[i].i = arguments[i];
+
+		const Instruction* const code = program.code.data();
+		const Value* const constants = program.constants.data();
+		const Function* const functions = program.functions.data();
+		const Value* const stackEnd = stack.data() + stack.size();
+		const Instruction* pc = code + called.entry;
+		Value* base = stack.data();
+		Instruction instruction;
+
+	#define R(operand) base[instruction.operand]
+
+#if THREED_VM_COMPUTED_GOTO
+		// Every handler ends in its own indirect jump, so the branch predictor
+		// learns which instruction tends to follow which
+		static void* const handlers[] = {
+		#define THREED_VM_LABEL(name) &&op_##name,
+			THREED_VM_OPS(THREED_VM_LABEL)
+		#undef THREED_VM_LABEL
+		};
+		static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Op::RET) + 1,
+			"dispatch table does not cover every Op");
+
+	#define THREED_VM_CASE(name) op_##name:
+	#define THREED_VM_NEXT()									\
+		instruction = *pc++;									\
+		goto *handlers[static_cast<uint8_t>(instruction.op)];
+
+		THREED_VM_NEXT()
+#else
+	#define THREED_VM_CASE(name) case Op::name:
+	#define THREED_VM_NEXT() continue;
+
+		for (;;)
+		{
+			instruction = *pc++;
+			switch (instruction.op)
+			{
+#endif
+
+		THREED_VM_CASE(LOADK)
+			R(a) = constants[instruction.bx()];
+			THREED_VM_NEXT()
+		THREED_VM_CASE(LOADI)
+			R(a).i = instruction.sbx();
+			THREED_VM_NEXT()
+		THREED_VM_CASE(MOVE)
+			R(a) = R(b);
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(ADD)
+			R(a).i = wrap(static_cast<uint64_t>(R(b).i) + static_cast<uint64_t>(R(c).i));
+			THREED_VM_NEXT()
+		THREED_VM_CASE(SUB)
+			R(a).i = wrap(static_cast<uint64_t>(R(b).i) - static_cast<uint64_t>(R(c).i));
+			THREED_VM_NEXT()
+		THREED_VM_CASE(MUL)
+			R(a).i = wrap(static_cast<uint64_t>(R(b).i) * static_cast<uint64_t>(R(c).i));
+			THREED_VM_NEXT()
+		THREED_VM_CASE(DIV)
+			// INT64_MIN / -1 overflows, as negation it wraps like the rest
+			if (R(c).i == 0)
+				goto divisionByZero;
+			R(a).i = R(c).i == -1 ? wrap(0 - static_cast<uint64_t>(R(b).i)) : R(b).i / R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(MOD)
+			if (R(c).i == 0)
+				goto divisionByZero;
+			R(a).i = R(c).i == -1 ? 0 : R(b).i % R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(ADDI)
+			R(a).i = wrap(static_cast<uint64_t>(R(b).i) + static_cast<uint64_t>(static_cast<int8_t>(instruction.c)));
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(FADD)
+			R(a).f = R(b).f + R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FSUB)
+			R(a).f = R(b).f - R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FMUL)
+			R(a).f = R(b).f * R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FDIV)
+			R(a).f = R(b).f / R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FMOD)
+			R(a).f = std::fmod(R(b).f, R(c).f);
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(EQ)
+			R(a).i = R(b).i == R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(NEQ)
+			R(a).i = R(b).i != R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(LT)
+			R(a).i = R(b).i < R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(LEQ)
+			R(a).i = R(b).i <= R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(GT)
+			R(a).i = R(b).i > R(c).i;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(GEQ)
+			R(a).i = R(b).i >= R(c).i;
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(FEQ)
+			R(a).i = R(b).f == R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FNEQ)
+			R(a).i = R(b).f != R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FLT)
+			R(a).i = R(b).f < R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FLEQ)
+			R(a).i = R(b).f <= R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FGT)
+			R(a).i = R(b).f > R(c).f;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FGEQ)
+			R(a).i = R(b).f >= R(c).f;
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(NOT)
+			R(a).i = R(b).i == 0;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(NEG)
+			R(a).i = wrap(0 - static_cast<uint64_t>(R(b).i));
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FNEG)
+			R(a).f = -R(b).f;
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(ITOF)
+			R(a).f = static_cast<double>(R(b).i);
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FTOI)
+			R(a).i = truncate(R(b).f);
+			THREED_VM_NEXT()
+		THREED_VM_CASE(BOOL)
+			R(a).i = R(b).i != 0;
+			THREED_VM_NEXT()
+		THREED_VM_CASE(FBOOL)
+			R(a).i = R(b).f != 0.0;
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(JMP)
+			pc += instruction.sbx();
+			THREED_VM_NEXT()
+		THREED_VM_CASE(JMPF)
+			if (R(a).i == 0)
+				pc += instruction.sbx();
+			THREED_VM_NEXT()
+		THREED_VM_CASE(JMPT)
+			if (R(a).i != 0)
+				pc += instruction.sbx();
+			THREED_VM_NEXT()
+
+		THREED_VM_CASE(CALL)
+		{
+			// The arguments already sit at the start of the callee's frame
+			auto& callee = functions[instruction.bx()];
+			Value* frame = &R(a);
+			if (frame + callee.registers > stackEnd || frames.size() == maxFrames)
+				goto stackOverflow;
+			frames.push_back({pc, base});
+			base = frame;
+			pc = code + callee.entry;
+			THREED_VM_NEXT()
+		}
+		THREED_VM_CASE(TAILCALL)
+		{
+			auto& callee = functions[instruction.bx()];
+			if (base + callee.registers > stackEnd)
+				goto stackOverflow;
+			for (unsigned i = 0; i < callee.parameters; i++)
+				base[i] = base[instruction.a + i];
+			pc = code + callee.entry;
+			THREED_VM_NEXT()
+		}
+		THREED_VM_CASE(RET)
+		{
+			// The result goes to the first register of the frame, the caller's R[a]
+			Value value = R(a);
+			if (frames.empty())
+			{
+				result = value.i;
+				return true;
+			}
+			base[0] = value;
+			pc = frames.back().returnPc;
+			base = frames.back().base;
+			frames.pop_back();
+			THREED_VM_NEXT()
+		}
+
+#if !THREED_VM_COMPUTED_GOTO
+			}
+		}
+#endif
+
+	#undef THREED_VM_NEXT
+	#undef THREED_VM_CASE
+	#undef R
+
+	divisionByZero:
+		return fail("Division by zero at instruction " + std::to_string(pc - 1 - code));
+	stackOverflow:
+		return fail("Stack overflow at instruction " + std::to_string(pc - 1 - code));
+	}
+
+}}
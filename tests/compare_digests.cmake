@@ -0,0 +1,20 @@
+# Runs every program in PROGRAMS with --digest under each THREED_SIMD choice,
+# fails if one fails or prints a digest unlike the others
+
+set(expected "")
+foreach (program IN LISTS PROGRAMS)
+	foreach (simd scalar sse2 avx2)
+		execute_process(COMMAND ${CMAKE_COMMAND} -E env THREED_SIMD=${simd} ${program} --digest
+			RESULT_VARIABLE result OUTPUT_VARIABLE digest ERROR_VARIABLE errors)
+		string(STRIP "${digest}" digest)
+		message(STATUS "${program} THREED_SIMD=${simd}: ${digest}")
+		if (NOT result EQUAL 0)
+			message(FATAL_ERROR "${program} failed with THREED_SIMD=${simd}:\n${errors}")
+		endif()
+		if (expected STREQUAL "")
+			set(expected "${digest}")
+		elseif (NOT digest STREQUAL expected)
+			message(FATAL_ERROR "${program} with THREED_SIMD=${simd} printed ${digest}, expected ${expected}")
+		endif()
+	endforeach()
+endforeach()
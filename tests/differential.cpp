@@ -0,0 +1,642 @@
+#include "corpus.hpp"
+
+#include "lexer/batch.hpp"
+#include "lexer/hash.hpp"
+#include "lexer/incremental.hpp"
+#include "lexer/lexer.hpp"
+#include "lexer/lookahead.hpp"
+#include "lexer/pipeline.hpp"
+#include "lexer/stream_lexer.hpp"
+#include "lexer/token_cache.hpp"
+#include "lexer/token_range.hpp"
+#include "lexer/scan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace threeD::Lexer;
+namespace Bench = threeD::Bench;
+
+/*
+ * Lexes generated and mangled inputs every way the library can and checks
+ * each result against one Lexer::tokenizeAll() of the same bytes:
+ *  - a nextToken() loop, a TokenRange and a PipelinedLexer
+ *  - checkpoint()/restore() and TokenLookahead marks, rewound at random
+ *  - lexChunked() with chunks down to one line
+ *  - lexFiles() of every input at once into a ConcurrentSymbolTable
+ *  - a TokenCache, as stored, as mapped back and after eviction
+ *  - relex() after random edits, against the edited text lexed whole
+ *  - a StreamLexer fed in random pieces through a small buffer
+ *  - the scan kernels in use against the scalar ones, byte by byte
+ * Values are compared resolved, an identifier by its name and a literal by
+ * its value, as every path numbers its tables its own way.
+ *
+ * --digest prints a hash of every reference stream and its diagnostics.
+ * Builds with the other dispatch and runs with other THREED_SIMD kernels
+ * must print the same one, see compare_digests.cmake.
+ */
+
+static constexpr Recovery recoveries[] = {Recovery::Stop, Recovery::NextCharacter, Recovery::NextSpace, Recovery::NextLine};
+
+// splitmix64, so every platform tests the same inputs
+class Random
+{
+public:
+	explicit Random(uint64_t seed) : state(seed) {}
+
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [0, n)
+	size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+
+private:
+	uint64_t state;
+};
+
+// Bytes that start, end or break tokens, comments and literals
+static const char* const fragments[] = {
+	"/*", "*/", "*", "/", "//", "\"", "\\", "'", "\n", " ", "\t", "0x", "0b1", "0o7", "12", ".5", "9.",
+	"e", "_x", "abc", "def", "true", "@", "$", "\x80", "\xff", ":=", "->", "==", "!", "&", "|",
+};
+
+struct Input
+{
+	std::string name;
+	std::string text;
+};
+
+static std::vector<Input> inputs()
+{
+	std::vector<Input> result = {
+		{"empty", ""},
+		{"newline", "\n"},
+		{"unterminated-string", "let s := \"abc\\\n"},
+		{"unterminated-char", "let c := '\\"},
+		{"unterminated-comment", "x /* never ends\n * at all"},
+		{"comment-end", "/**/ a /***/ b /* * / */ c /"},
+		{"long-identifier", std::string(100, 'a') + " " + std::string(63, '_') + "1 " + std::string(65, 'z')},
+		{"long-digits", std::string(31, '7') + " " + std::string(33, '1') + " 0x" + std::string(17, 'f') + " 1." + std::string(40, '2')},
+		{"long-comment", "// " + std::string(200, '-') + "\n/*" + std::string(130, ' ') + "*/x"},
+		{"bad-bytes", "a\x01 b\x7f c\x80\xfe d @ $ ` #"},
+		{"no-final-newline", "def f(x: int) -> int:\n\tret x"},
+	};
+
+	for (auto mix : Bench::allMixes)
+	{
+		Bench::CorpusOptions options;
+		options.mix = mix;
+		options.bytes = 24 << 10;
+		options.files = 2;
+		options.seed = 7;
+		auto corpus = Bench::generateCorpus(options);
+		for (size_t i = 0; i < corpus.size(); i++)
+			result.push_back({std::string(Bench::mixName(mix)) + std::to_string(i), corpus[i]});
+
+		// The corpus lexes cleanly, its mangled copies exercise every error path
+		Random random(static_cast<uint64_t>(mix) + 1);
+		auto mangled = corpus[0];
+		for (size_t i = 0; i < mangled.size() / 200; i++)
+			mangled.replace(random.below(mangled.size()), random.below(3), fragments[random.below(std::size(fragments))]);
+		result.push_back({std::string(Bench::mixName(mix)) + "-mangled", mangled});
+	}
+	return result;
+}
+
+// A token with its value resolved, the same whichever tables it came with
+struct Resolved
+{
+	TokenType type;
+	uint64_t offset;
+	uint32_t length;
+	std::string value;
+
+	bool operator==(const Resolved&) const = default;
+};
+
+static std::ostream& operator<<(std::ostream& out, const Resolved& token)
+{
+	return out << token.type << " at " << token.offset << "+" << token.length << " value \"" << token.value << "\"";
+}
+
+static std::string resolve(TokenType type, uint32_t value, const LiteralTable* literals, const SymbolTable* symbols)
+{
+	switch (type)
+	{
+	case TokenType::IDENTIFIER:
+		return std::string(symbols->name(value));
+	case TokenType::INT_LITERAL:
+		return std::to_string(literals->integer(value));
+	case TokenType::FLOAT_LITERAL:
+	{
+		// Bit for bit, a decoding difference may well be in the last digit
+		uint64_t bits;
+		double floating = literals->floating(value);
+		std::memcpy(&bits, &floating, sizeof(bits));
+		return std::to_string(bits);
+	}
+	case TokenType::STR_LITERAL:
+		return std::string(literals->string(value));
+	default:
+		return std::to_string(value);
+	}
+}
+
+static std::vector<Resolved> resolveAll(const TokenStreamView& stream)
+{
+	std::vector<Resolved> tokens;
+	for (size_t i = 0; i < stream.size(); i++)
+		tokens.push_back({stream.types[i], stream.offsets[i], stream.lengths[i], resolve(stream.types[i], stream.values[i], stream.literals, stream.symbols)});
+	return tokens;
+}
+
+// What a path produced for one input, in the form the reference is kept in
+struct Outcome
+{
+	std::vector<Resolved> tokens;
+	std::vector<std::string> diagnostics;
+};
+
+static std::vector<std::string> describe(const DiagnosticEngine& diagnostics)
+{
+	std::vector<std::string> result;
+	for (auto& diagnostic : diagnostics.all())
+		result.push_back(std::to_string(diagnostic.offset) + ": " + diagnostic.message);
+	return result;
+}
+
+static Outcome lexed(Lexer& lexer, const std::vector<Token>& tokens)
+{
+	Outcome outcome;
+	for (auto& token : tokens)
+		outcome.tokens.push_back({token.type, token.offset, token.length, resolve(token.type, token.value, &lexer.literals(), &lexer.symbols())});
+	outcome.diagnostics = describe(lexer.diagnostics());
+	return outcome;
+}
+
+class Checker
+{
+public:
+	// Compares outcome against expected, reporting the first difference
+	void compare(const std::string& path, const std::string& input, Recovery recovery, const Outcome& expected, const Outcome& outcome)
+	{
+		checks++;
+		auto where = path + " on " + input + " (recovery " + std::to_string(static_cast<int>(recovery)) + ")";
+		if (!same(where, "token", expected.tokens, outcome.tokens))
+			return;
+		same(where, "diagnostic", expected.diagnostics, outcome.diagnostics);
+	}
+
+	void fail(const std::string& message)
+	{
+		if (failures++ < 20)
+			std::cerr << "FAIL " << message << std::endl;
+	}
+
+	size_t checks = 0;
+	size_t failures = 0;
+
+private:
+	template<typename T>
+	bool same(const std::string& where, const char* what, const std::vector<T>& expected, const std::vector<T>& actual)
+	{
+		auto mismatch = std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end());
+		if (mismatch.first == expected.end() && mismatch.second == actual.end())
+			return true;
+
+		std::ostringstream message;
+		message << where << ": " << what << " " << (mismatch.first - expected.begin()) << " of " << expected.size() << " expected ";
+		if (mismatch.first != expected.end())
+			message << *mismatch.first;
+		else
+			message << "none";
+		message << ", got ";
+		if (mismatch.second != actual.end())
+			message << *mismatch.second;
+		else
+			message << "none (" << actual.size() << " in all)";
+		fail(message.str());
+		return false;
+	}
+};
+
+static void checkLexers(Checker& checker, const Input& input, Recovery recovery, const Outcome& reference)
+{
+	SourceManager sources;
+	auto file = sources.addBuffer(input.name, SourceBuffer(input.text));
+
+	{
+		Lexer lexer(sources, file);
+		lexer.setRecovery(recovery);
+		std::vector<Token> tokens;
+		for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken())
+			tokens.push_back(token);
+		checker.compare("nextToken", input.name, recovery, reference, lexed(lexer, tokens));
+	}
+
+	{
+		Lexer lexer(sources, file);
+		lexer.setRecovery(recovery);
+		std::vector<Token> tokens;
+		for (const Token& token : TokenRange(lexer))
+			tokens.push_back(token);
+		checker.compare("TokenRange", input.name, recovery, reference, lexed(lexer, tokens));
+	}
+
+	{
+		// Two batches in flight, so the threads wait on each other often
+		Lexer lexer(sources, file);
+		lexer.setRecovery(recovery);
+		std::vector<Token> tokens;
+		{
+			PipelinedLexer pipeline(lexer, 2);
+			for (auto token = pipeline.next(); token.type != TokenType::EOF_; token = pipeline.next())
+				tokens.push_back(token);
+		}
+		checker.compare("PipelinedLexer", input.name, recovery, reference, lexed(lexer, tokens));
+	}
+}
+
+// Lexes ahead from random points and goes back, the tokens read past the mark do not count
+static void checkBacktracking(Checker& checker, const Input& input, Recovery recovery, const Outcome& reference, Random& random)
+{
+	SourceManager sources;
+	auto file = sources.addBuffer(input.name, SourceBuffer(input.text));
+
+	{
+		Lexer lexer(sources, file);
+		lexer.setRecovery(recovery);
+		std::vector<Token> tokens;
+		for (;;)
+		{
+			if (random.below(8) == 0)
+			{
+				auto checkpoint = lexer.checkpoint();
+				for (auto ahead = random.below(20); ahead > 0 && lexer.nextToken().type != TokenType::EOF_; ahead--)
+					;
+				lexer.restore(checkpoint);
+			}
+			auto token = lexer.nextToken();
+			if (token.type == TokenType::EOF_)
+				break;
+			tokens.push_back(token);
+		}
+		checker.compare("checkpoint/restore", input.name, recovery, reference, lexed(lexer, tokens));
+	}
+
+	{
+		// A small ring, so marks that pin many tokens make it grow
+		Lexer lexer(sources, file);
+		lexer.setRecovery(recovery);
+		TokenLookahead lookahead(lexer, 4);
+		std::vector<Token> tokens;
+		auto lookAhead = [&]() {
+			lookahead.peek(random.below(12));
+			lookahead.skip(random.below(20));
+		};
+		for (;;)
+		{
+			if (random.below(8) == 0)
+			{
+				auto outer = lookahead.mark();
+				lookAhead();
+				if (random.below(2) == 0)
+				{
+					auto inner = lookahead.mark();
+					lookAhead();
+					lookahead.rewind(inner);
+					lookahead.release(inner);
+				}
+				lookahead.rewind(outer);
+				lookahead.release(outer);
+			}
+			auto token = lookahead.next();
+			if (token.type == TokenType::EOF_)
+				break;
+			tokens.push_back(token);
+		}
+		checker.compare("TokenLookahead", input.name, recovery, reference, lexed(lexer, tokens));
+	}
+}
+
+static void checkChunked(Checker& checker, ThreadPool& pool, const Input& input, Recovery recovery, const Outcome& reference)
+{
+	SourceManager sources;
+	auto file = sources.addBuffer(input.name, SourceBuffer(input.text));
+	for (size_t chunkSize : {1, 97, 4096})
+	{
+		auto result = lexChunked(sources, file, pool, recovery, chunkSize);
+		Outcome outcome;
+		outcome.tokens = resolveAll(result.tokens);
+		outcome.diagnostics = describe(result.diagnostics);
+		checker.compare("lexChunked/" + std::to_string(chunkSize), input.name, recovery, reference, outcome);
+	}
+}
+
+// All inputs on the pool at once, every name interned by whichever worker got there first
+static void checkShared(Checker& checker, ThreadPool& pool, const std::vector<Input>& all, Recovery recovery, const std::vector<Outcome>& references)
+{
+	SourceManager sources;
+	std::vector<FileId> files;
+	for (auto& input : all)
+		files.push_back(sources.addBuffer(input.name, SourceBuffer(input.text)));
+	ConcurrentSymbolTable symbols;
+	auto results = lexFiles(sources, files, pool, recovery, &symbols);
+
+	std::vector<std::string> names;
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		auto& stream = results[i].tokens;
+		Outcome outcome;
+		for (size_t t = 0; t < stream.size(); t++)
+		{
+			auto type = stream.types[t];
+			auto value = type == TokenType::IDENTIFIER ? symbols.name(stream.values[t]) : resolve(type, stream.values[t], &stream.literals, nullptr);
+			outcome.tokens.push_back({type, stream.offsets[t], stream.lengths[t], value});
+		}
+		outcome.diagnostics = describe(results[i].diagnostics);
+		checker.compare("lexFiles/shared", all[i].name, recovery, references[i], outcome);
+
+		for (auto& token : references[i].tokens)
+		{
+			if (token.type == TokenType::IDENTIFIER)
+				names.push_back(token.value);
+		}
+	}
+
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+	checker.checks++;
+	if (symbols.size() != names.size())
+		checker.fail("lexFiles/shared interned " + std::to_string(symbols.size()) + " names for " + std::to_string(names.size())
+			+ " distinct identifiers (recovery " + std::to_string(static_cast<int>(recovery)) + ")");
+}
+
+// Every input stored, mapped back, then again through a cache too small to keep any entry
+static void checkCache(Checker& checker, const std::vector<Input>& all, Recovery recovery, const std::vector<Outcome>& references)
+{
+	auto directory = std::filesystem::temp_directory_path()
+		/ ("threeD_differential-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+	auto where = " (recovery " + std::to_string(static_cast<int>(recovery)) + ")";
+	SourceManager sources;
+	std::vector<FileId> files;
+	for (auto& input : all)
+		files.push_back(sources.addBuffer(input.name, SourceBuffer(input.text)));
+
+	auto check = [&](TokenCache& cache, const char* path, bool hit) {
+		for (size_t i = 0; i < all.size(); i++)
+		{
+			auto cached = cache.get(sources, files[i], recovery);
+			Outcome outcome;
+			outcome.tokens = resolveAll(cached.tokens);
+			outcome.diagnostics = describe(cached.diagnostics);
+			checker.compare(path, all[i].name, recovery, references[i], outcome);
+			checker.checks++;
+			if (cached.hit != hit)
+				checker.fail(std::string(path) + " on " + all[i].name + where + (hit ? " missed" : " hit"));
+		}
+	};
+
+	uint64_t stored;
+	{
+		TokenCache cache(directory.string());
+		check(cache, "TokenCache/stored", false);
+		check(cache, "TokenCache/mapped", true);
+		stored = cache.stats().stores;
+	}
+	{
+		// Every entry goes, and so does each one stored after
+		TokenCache cache(directory.string(), 1);
+		cache.evict();
+		checker.checks++;
+		if (cache.stats().evictions != stored || cache.diskUsage() != 0)
+			checker.fail("TokenCache evicted " + std::to_string(cache.stats().evictions) + " of " + std::to_string(stored)
+				+ " entries, " + std::to_string(cache.diskUsage()) + " bytes left" + where);
+		check(cache, "TokenCache/evicted", false);
+	}
+	std::filesystem::remove_all(directory);
+}
+
+// Diagnostics of relex() cover only the lexed region, the tokens are compared alone
+static void checkRelex(Checker& checker, const Input& input, Recovery recovery, Random& random)
+{
+	SourceManager sources;
+	auto text = input.text;
+	auto file = sources.addBuffer(input.name, SourceBuffer::fromString(text));
+	Lexer first(sources, file);
+	first.setRecovery(recovery);
+	auto stream = first.tokenizeAll();
+
+	for (int edit = 0; edit < 6; edit++)
+	{
+		auto offset = random.below(text.size() + 1);
+		auto removed = std::min(random.below(12), text.size() - offset);
+		std::string inserted;
+		for (size_t pieces = random.below(4); pieces > 0; pieces--)
+			inserted += fragments[random.below(std::size(fragments))];
+		text.replace(offset, removed, inserted);
+		sources.replace(file, SourceBuffer::fromString(text));
+		relex(sources, file, stream, {static_cast<uint32_t>(offset), static_cast<uint32_t>(removed), static_cast<uint32_t>(inserted.size())}, nullptr, recovery);
+
+		Lexer whole(sources, file);
+		whole.setRecovery(recovery);
+		auto expected = whole.tokenizeAll();
+		Outcome wanted, outcome;
+		wanted.tokens = resolveAll(expected);
+		outcome.tokens = resolveAll(stream);
+		checker.compare("relex/" + std::to_string(edit), input.name, recovery, wanted, outcome);
+		if (wanted.tokens != outcome.tokens)
+			return;
+	}
+}
+
+// Stream diagnostics carry their line and column, the reference ones are rendered alike
+static void checkStream(Checker& checker, const Input& input, Recovery recovery, const Outcome& reference, const DiagnosticEngine& diagnostics, Random& random)
+{
+	SourceManager sources;
+	auto file = sources.addBuffer(input.name, SourceBuffer(input.text));
+	Outcome expected;
+	expected.tokens = reference.tokens;
+	for (auto& diagnostic : diagnostics.all())
+	{
+		auto at = sources.location(file, diagnostic.offset);
+		expected.diagnostics.push_back(input.name + ":" + std::to_string(at.line) + ":" + std::to_string(at.column) + ": " + diagnostic.message);
+	}
+
+	// Small enough to move the pending bytes often, large enough for every token
+	size_t longest = 0;
+	for (auto& token : reference.tokens)
+		longest = std::max<size_t>(longest, token.length);
+	Outcome outcome;
+	SymbolTable names;
+	StreamLexer lexer([&](const StreamToken& token) {
+		outcome.tokens.push_back({token.type, token.offset, static_cast<uint32_t>(token.lexeme.size()),
+			resolve(token.type, token.value, token.literals, &names)});
+	}, std::max<size_t>(64, 2 * longest + 2), input.name);
+	lexer.internInto(names);
+	lexer.setRecovery(recovery);
+	// Past the limit diagnostics are only counted, the first ones are kept as they were
+	auto limit = random.below(expected.diagnostics.size() + 2);
+	lexer.limitDiagnostics(limit);
+
+	for (size_t at = 0; at < input.text.size();)
+	{
+		auto size = std::min(1 + random.below(random.below(4) == 0 ? 200 : 8), input.text.size() - at);
+		lexer.feed(input.text.data() + at, size);
+		at += size;
+	}
+	lexer.finish();
+	for (auto& diagnostic : lexer.diagnostics().all())
+		outcome.diagnostics.push_back(diagnostic.message);
+	auto reported = expected.diagnostics.size();
+	if (reported > limit)
+		expected.diagnostics.resize(limit);
+	checker.compare("StreamLexer", input.name, recovery, expected, outcome);
+	checker.checks++;
+	if (lexer.diagnostics().size() + lexer.diagnosticsDropped() != reported)
+		checker.fail("StreamLexer on " + input.name + " kept " + std::to_string(lexer.diagnostics().size()) + " and dropped "
+			+ std::to_string(lexer.diagnosticsDropped()) + " of " + std::to_string(reported) + " diagnostics");
+
+	// Names of tokens cut by a read and lexed again must not reach the table
+	std::vector<std::string> delivered;
+	for (auto& token : reference.tokens)
+	{
+		if (token.type == TokenType::IDENTIFIER)
+			delivered.push_back(token.value);
+	}
+	std::sort(delivered.begin(), delivered.end());
+	delivered.erase(std::unique(delivered.begin(), delivered.end()), delivered.end());
+	checker.checks++;
+	if (names.size() != delivered.size())
+		checker.fail("StreamLexer on " + input.name + " interned " + std::to_string(names.size()) + " names for "
+			+ std::to_string(delivered.size()) + " distinct identifiers");
+}
+
+// Every kernel from every position, with ends that cut a vector short
+static void checkKernels(Checker& checker, const Input& input)
+{
+	auto& simd = Scan::kernels();
+	auto& scalar = Scan::scalarKernels();
+	if (&simd == &scalar)
+		return;
+
+	using Kernel = const char* (*)(const char*, const char*);
+	const std::pair<const char*, Kernel Scan::Kernels::*> kernels[] = {
+		{"identifier", &Scan::Kernels::identifier}, {"digits", &Scan::Kernels::digits},
+		{"blanks", &Scan::Kernels::blanks}, {"stringBody", &Scan::Kernels::stringBody},
+		{"lineComment", &Scan::Kernels::lineComment}, {"blockComment", &Scan::Kernels::blockComment},
+	};
+
+	auto begin = input.text.data();
+	auto size = input.text.size();
+	for (size_t p = 0; p < size; p++)
+	{
+		for (size_t length : {size_t(1), size_t(15), size_t(17), size_t(31), size_t(33), size_t(64), size - p})
+		{
+			auto end = begin + std::min(size, p + length);
+			for (auto& [name, kernel] : kernels)
+			{
+				checker.checks++;
+				auto expected = (scalar.*kernel)(begin + p, end);
+				auto actual = (simd.*kernel)(begin + p, end);
+				if (actual != expected)
+					checker.fail(std::string(simd.name) + " " + name + " on " + input.name + " from " + std::to_string(p) + " to "
+						+ std::to_string(end - begin) + ": expected " + std::to_string(expected - begin) + ", got " + std::to_string(actual - begin));
+			}
+		}
+	}
+
+	for (size_t p = 0; p < size; p += 1 + p / 8)
+	{
+		checker.checks++;
+		std::vector<uint32_t> expected, actual;
+		scalar.lineStarts(begin + p, begin + size, expected);
+		simd.lineStarts(begin + p, begin + size, actual);
+		if (actual != expected)
+			checker.fail(std::string(simd.name) + " lineStarts on " + input.name + " from " + std::to_string(p));
+	}
+}
+
+static void usage()
+{
+	std::cerr << "usage: threeD_differential [--digest]" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	bool digest = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--digest")
+			digest = true;
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+
+	Checker checker;
+	ThreadPool pool(2);
+	uint64_t hash = 0;
+	auto all = inputs();
+	std::vector<std::vector<Outcome>> references(std::size(recoveries));
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		auto& input = all[i];
+		checkKernels(checker, input);
+		Random random(i + 1);
+		for (size_t r = 0; r < std::size(recoveries); r++)
+		{
+			auto recovery = recoveries[r];
+			SourceManager sources;
+			auto file = sources.addBuffer(input.name, SourceBuffer(input.text));
+			Lexer lexer(sources, file);
+			lexer.setRecovery(recovery);
+			auto stream = lexer.tokenizeAll();
+			Outcome reference;
+			reference.tokens = resolveAll(stream);
+			reference.diagnostics = describe(lexer.diagnostics());
+
+			for (auto& token : reference.tokens)
+			{
+				hash = mixHash(hash ^ (uint64_t(token.type) << 48 ^ token.offset << 16 ^ token.length));
+				hash = mixHash(hash ^ contentHash(token.value));
+			}
+			for (auto& diagnostic : reference.diagnostics)
+				hash = mixHash(hash ^ contentHash(diagnostic));
+
+			checkLexers(checker, input, recovery, reference);
+			checkBacktracking(checker, input, recovery, reference, random);
+			checkChunked(checker, pool, input, recovery, reference);
+			checkRelex(checker, input, recovery, random);
+			checkStream(checker, input, recovery, reference, lexer.diagnostics(), random);
+			references[r].push_back(std::move(reference));
+		}
+	}
+
+	for (size_t r = 0; r < std::size(recoveries); r++)
+	{
+		checkShared(checker, pool, all, recoveries[r], references[r]);
+		checkCache(checker, all, recoveries[r], references[r]);
+	}
+
+	if (digest)
+		std::cout << std::hex << hash << std::endl;
+	std::cerr << all.size() << " inputs, " << checker.checks << " checks, " << checker.failures << " failures, kernels "
+		<< Scan::kernels().name << std::endl;
+	return checker.failures ? 1 : 0;
+}
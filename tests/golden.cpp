@@ -0,0 +1,94 @@
+#include "lexer/lexer.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace threeD::Lexer;
+
+/*
+ * Lexes each source and compares its tokens with a dump the baseline lexer
+ * made of it, see tests/golden/. A dump has a type and a lexeme per line as
+ * threeDLex --tokens prints them, lines starting with '#' are notes, and a
+ * line "error" is where the baseline gave up: an ERROR token must come next
+ * and nothing after it is compared. Otherwise the tokens must end with the
+ * dump and lex without diagnostics.
+ */
+
+static bool readFile(const char* path, std::string& text)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		return false;
+	std::ostringstream contents;
+	contents << in.rdbuf();
+	text = contents.str();
+	return true;
+}
+
+static bool matches(const char* sourcePath, const char* goldenPath)
+{
+	std::string text, golden;
+	if (!readFile(sourcePath, text) || !readFile(goldenPath, golden))
+	{
+		std::cerr << "Could not open " << sourcePath << " or " << goldenPath << std::endl;
+		return false;
+	}
+
+	SourceManager sources;
+	auto file = sources.addBuffer(sourcePath, SourceBuffer(text));
+	Lexer lexer(sources, file);
+
+	std::istringstream lines(golden);
+	std::string expected;
+	size_t lineNumber = 0;
+	while (std::getline(lines, expected))
+	{
+		lineNumber++;
+		if (expected.empty() || expected[0] == '#')
+			continue;
+
+		auto token = lexer.nextToken();
+		if (expected == "error")
+		{
+			if (token.type == TokenType::ERROR)
+				return true;
+			std::cerr << "FAIL " << goldenPath << ":" << lineNumber << ": expected an ERROR token, got " << token.type << std::endl;
+			return false;
+		}
+
+		std::ostringstream actual;
+		actual << token.type << " " << lexer.lexeme(token);
+		if (actual.str() != expected)
+		{
+			std::cerr << "FAIL " << goldenPath << ":" << lineNumber << ": expected " << expected << ", got " << actual.str() << std::endl;
+			return false;
+		}
+	}
+
+	auto token = lexer.nextToken();
+	if (token.type != TokenType::EOF_ || !lexer.diagnostics().empty())
+	{
+		std::cerr << "FAIL " << goldenPath << ": expected the end, got " << token.type << " and "
+			<< lexer.diagnostics().size() << " diagnostics" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3 || argc % 2 == 0)
+	{
+		std::cerr << "usage: threeD_golden <source> <tokens>..." << std::endl;
+		return 2;
+	}
+
+	size_t failures = 0;
+	for (int i = 1; i + 1 < argc; i += 2)
+		failures += !matches(argv[i], argv[i + 1]);
+	std::cerr << (argc - 1) / 2 << " sources, " << failures << " failures" << std::endl;
+	return failures ? 1 : 0;
+}
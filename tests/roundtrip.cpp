@@ -0,0 +1,93 @@
+#include "corpus.hpp"
+
+#include "lexer/lexer.hpp"
+#include "parser/parser.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace threeD::Lexer;
+namespace Bench = threeD::Bench;
+namespace Parser = threeD::Parser;
+
+/*
+ * Parses every script given and a generated corpus of each mix, prints the
+ * tree back as source and checks that the printed source is a fixed point:
+ * it parses without errors and prints as the same text again.
+ */
+
+struct Printed
+{
+	std::string text;
+	size_t errors;
+};
+
+static Printed parseAndPrint(const std::string& name, const std::string& text)
+{
+	SourceManager sources;
+	auto file = sources.addBuffer(name, SourceBuffer(text));
+	Lexer lexer(sources, file);
+	auto stream = lexer.tokenizeAll();
+	DiagnosticEngine errors;
+	auto ast = Parser::parse(stream, text, errors);
+	std::ostringstream out;
+	Parser::print(out, ast, stream, text);
+	return {out.str(), lexer.diagnostics().size() + errors.size()};
+}
+
+static bool roundTrip(const std::string& name, const std::string& text)
+{
+	auto first = parseAndPrint(name, text);
+	auto second = parseAndPrint(name + " printed", first.text);
+	if (second.errors > 0)
+	{
+		std::cerr << "FAIL " << name << ": the printed source has " << second.errors << " errors" << std::endl;
+		return false;
+	}
+	if (second.text != first.text)
+	{
+		auto at = std::mismatch(first.text.begin(), first.text.end(), second.text.begin(), second.text.end()).first - first.text.begin();
+		std::cerr << "FAIL " << name << ": printed again it differs at byte " << at << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	size_t inputs = 0, failures = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		std::ifstream in(argv[i], std::ios::binary);
+		if (!in)
+		{
+			std::cerr << "Could not open " << argv[i] << std::endl;
+			return 2;
+		}
+		std::ostringstream text;
+		text << in.rdbuf();
+		inputs++;
+		failures += !roundTrip(argv[i], text.str());
+	}
+
+	for (auto mix : Bench::allMixes)
+	{
+		Bench::CorpusOptions options;
+		options.mix = mix;
+		options.bytes = 64 << 10;
+		options.files = 4;
+		options.seed = 7;
+		auto corpus = Bench::generateCorpus(options);
+		for (size_t i = 0; i < corpus.size(); i++)
+		{
+			inputs++;
+			failures += !roundTrip(std::string(Bench::mixName(mix)) + std::to_string(i), corpus[i]);
+		}
+	}
+
+	std::cerr << inputs << " inputs, " << failures << " failures" << std::endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,219 @@
+#include "lexer/batch.hpp"
+#include "lexer/instrument.hpp"
+#include "lexer/stream_lexer.hpp"
+#include "lexer/token_cache.hpp"
+#include "parser/parser.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+using namespace threeD::Lexer;
+
+static void usage()
+{
+	std::cerr << "usage: threeDLex [-j workers] [--chunked] [--tokens] [--ast] [--recovery stop|char|space|line] [--stats]\n"
+		"                 [--cache directory] [--cache-budget MB] <file or directory>...\n"
+		"       threeDLex [--buffer bytes] [--tokens] [--recovery stop|char|space|line] [--stats] -" << std::endl;
+}
+
+// Lexes standard input as it arrives, in a buffer of at most capacity bytes
+static int lexStandardInput(size_t capacity, bool printTokens, bool printStats, Recovery recovery)
+{
+	auto start = std::chrono::steady_clock::now();
+	StreamLexer lexer([&](const StreamToken& token) {
+		if (printTokens)
+			std::cout << token.type << " " << token.lexeme << "\n";
+	}, capacity, "<stdin>");
+	lexer.setRecovery(recovery);
+	lexer.lex(0);
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	SourceManager sources;
+	lexer.diagnostics().print(std::cerr, sources);
+	if (lexer.diagnosticsDropped())
+		std::cerr << "error: " << lexer.diagnosticsDropped() << " more errors not shown" << std::endl;
+	std::cerr << lexer.bytes() << " bytes, " << lexer.tokens() << " tokens, " << lexer.diagnostics().size() + lexer.diagnosticsDropped()
+		<< " errors in " << seconds * 1000 << " ms" << std::endl;
+	if (printStats)
+		LexerStats::global().print(std::cerr);
+	return lexer.diagnostics().empty() ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned workers = 0;
+	bool printTokens = false;
+	bool printAst = false;
+	bool chunked = false;
+	bool printStats = false;
+	bool standardInput = false;
+	size_t capacity = 1 << 16;
+	std::string cacheDirectory;
+	uint64_t cacheBudget = uint64_t(256) << 20;
+	Recovery recovery = Recovery::NextCharacter;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "-j" && i + 1 < argc)
+			workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+		else if (arg == "--tokens")
+			printTokens = true;
+		else if (arg == "--ast")
+			printAst = true;
+		else if (arg == "--chunked")
+			chunked = true;
+		else if (arg == "--stats")
+			printStats = true;
+		else if (arg == "--buffer" && i + 1 < argc)
+			capacity = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--cache" && i + 1 < argc)
+			cacheDirectory = argv[++i];
+		else if (arg == "--cache-budget" && i + 1 < argc)
+			cacheBudget = static_cast<uint64_t>(std::strtod(argv[++i], nullptr) * (1 << 20));
+		else if (arg == "-")
+			standardInput = true;
+		else if (arg == "--recovery" && i + 1 < argc)
+		{
+			std::string mode = argv[++i];
+			if (mode == "stop")
+				recovery = Recovery::Stop;
+			else if (mode == "char")
+				recovery = Recovery::NextCharacter;
+			else if (mode == "space")
+				recovery = Recovery::NextSpace;
+			else if (mode == "line")
+				recovery = Recovery::NextLine;
+			else
+			{
+				usage();
+				return 2;
+			}
+		}
+		else if (!arg.empty() && arg[0] == '-')
+		{
+			usage();
+			return 2;
+		}
+		else if (std::filesystem::is_directory(arg))
+		{
+			auto scripts = findScripts(arg);
+			paths.insert(paths.end(), scripts.begin(), scripts.end());
+		}
+		else
+			paths.push_back(arg);
+	}
+
+	if (standardInput && paths.empty())
+		return lexStandardInput(capacity, printTokens, printStats, recovery);
+
+	if (paths.empty() || standardInput)
+	{
+		usage();
+		return 2;
+	}
+
+	SourceManager sources;
+	ThreadPool pool(workers);
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<LexedFile> results;
+	std::vector<CachedTokens> cached;
+	std::unique_ptr<TokenCache> cache;
+	if (!cacheDirectory.empty())
+	{
+		// Unchanged scripts are mapped from the cache instead of lexed
+		cache = std::make_unique<TokenCache>(cacheDirectory, cacheBudget);
+		results.resize(paths.size());
+		cached.resize(paths.size());
+		std::vector<size_t> items(paths.size());
+		std::iota(items.begin(), items.end(), 0);
+		pool.run(items, [&](size_t i) {
+			auto file = sources.addFile(paths[i], &results[i].diagnostics);
+			if (file != InvalidFileId)
+			{
+				results[i].file = file;
+				cached[i] = cache->get(sources, file, recovery);
+			}
+		});
+	}
+	else if (chunked)
+	{
+		// One file at a time, each split across every worker
+		for (auto& path : paths)
+		{
+			DiagnosticEngine rejected;
+			auto file = sources.addFile(path, &rejected);
+			if (file != InvalidFileId)
+				results.push_back(lexChunked(sources, file, pool, recovery));
+			else
+			{
+				results.emplace_back();
+				results.back().diagnostics = std::move(rejected);
+			}
+		}
+	}
+	else
+		results = lexFiles(sources, paths, pool, recovery);
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Results come back in the order the paths were given
+	size_t tokens = 0, bytes = 0, errors = 0;
+	for (size_t r = 0; r < results.size(); r++)
+	{
+		auto& result = results[r];
+		auto& diagnostics = cache && result.file != InvalidFileId ? cached[r].diagnostics : result.diagnostics;
+		diagnostics.print(std::cerr, sources);
+		errors += diagnostics.size();
+
+		if (result.file == InvalidFileId)
+			continue;
+
+		auto source = sources.contents(result.file);
+		auto stream = cache ? cached[r].tokens : TokenStreamView(result.tokens);
+		tokens += stream.size();
+		bytes += source.size();
+
+		if (printTokens)
+		{
+			for (size_t i = 0; i < stream.size(); i++)
+				std::cout << stream.types[i] << " " << stream.lexeme(i, source) << "\n";
+		}
+
+		// Parsed after lexing is timed, the parse errors count with the lexer's
+		if (printAst)
+		{
+			DiagnosticEngine parseErrors;
+			auto ast = threeD::Parser::parse(stream, source, parseErrors);
+			threeD::Parser::print(std::cout, ast, stream, source);
+			parseErrors.print(std::cerr, sources);
+			errors += parseErrors.size();
+		}
+	}
+
+	std::cerr << results.size() << " files, " << bytes << " bytes, " << tokens << " tokens, "
+		<< errors << " errors in " << seconds * 1000 << " ms on " << pool.size() << " workers";
+	if (seconds > 0)
+		std::cerr << " (" << bytes / seconds / 1e6 << " MB/s)";
+	std::cerr << std::endl;
+
+	if (cache)
+	{
+		auto stats = cache->stats();
+		std::cerr << "cache: " << stats.hits << " hits, " << stats.misses << " misses, " << stats.stores << " stored, "
+			<< stats.evictions << " evicted, " << cache->diskUsage() << " bytes in " << cache->directory() << std::endl;
+	}
+
+	// Every lexer has been destroyed by now, so the global counts are complete
+	if (printStats)
+		LexerStats::global().print(std::cerr);
+
+	return errors ? 1 : 0;
+}